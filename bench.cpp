@@ -0,0 +1,341 @@
+/* Benchmark of raid_start_times
+ *
+ * Build (from repository root):
+ *   g++ -std=c++11 -O2 bench.cpp raid_solver.cpp -o bench
+ *
+ * Usage:
+ *   bench [--raid-times MIN-MAX] [--players N,N,...] [--distribution NAME]
+ *         [--budget-ms MS] [--seed S] [--output FILE]
+ *   bench --generate PLAYERS RAID_TIMES DISTRIBUTION [SEED]
+ *
+ * Sweeps number of raid times and roster sizes over synthetic rosters and
+ * measures throughput of parsing, enumeration of candidates and scoring of
+ * candidates. Results are written as JSON, so runs can be compared between
+ * versions and engines. Each measurement runs at most for budget milliseconds,
+ * so rosters too large to be fully scored are measured on first candidates.
+ * Registered engines can't be stopped early, they are run only when the
+ * reference would score all candidates within engine_budget_factor budgets,
+ * their speedup is relative to scoring throughput of the reference.
+ */
+
+#include "raid_solver.hpp"
+#include "roster_generator.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+typedef std::chrono::steady_clock search_clock;
+
+struct bench_options
+{
+	unsigned int min_raid_times = 1;
+	unsigned int max_raid_times = 12;
+	std::vector<unsigned int> players = {10, 100, 1000, 10000, 100000};
+	std::vector<roster_generator_options::distribution_id> distributions = {
+		roster_generator_options::evening, roster_generator_options::timezones, roster_generator_options::duplicates};
+	unsigned int budget_ms = 100;
+	unsigned int seed = 1;
+	std::string output;
+
+	static const std::string usage;
+
+	void parse(int argc, char* argv[])
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string option = argv[i];
+			if (option == "--raid-times" && i + 1 < argc)
+			{
+				const std::string value = argv[++i];
+				const auto dash = value.find('-');
+				min_raid_times = parse_unsigned(option, value.substr(0, dash));
+				max_raid_times = dash == std::string::npos ? min_raid_times : parse_unsigned(option, value.substr(dash + 1));
+				if (!roster_generator_options::is_valid_raid_times(min_raid_times) || !roster_generator_options::is_valid_raid_times(max_raid_times) ||
+						min_raid_times > max_raid_times)
+				{
+					throw std::runtime_error("Invalid range of raid times: " + value + "\n" + usage);
+				}
+			}
+			else if (option == "--players" && i + 1 < argc)
+			{
+				players.clear();
+				std::istringstream list(argv[++i]);
+				std::string value;
+				while (std::getline(list, value, ','))
+				{
+					players.push_back(parse_unsigned(option, value));
+				}
+			}
+			else if (option == "--distribution" && i + 1 < argc)
+			{
+				distributions = {roster_generator_options::parse_distribution(argv[++i])};
+			}
+			else if (option == "--budget-ms" && i + 1 < argc)
+			{
+				budget_ms = parse_unsigned(option, argv[++i]);
+			}
+			else if (option == "--seed" && i + 1 < argc)
+			{
+				seed = parse_unsigned(option, argv[++i]);
+			}
+			else if (option == "--output" && i + 1 < argc)
+			{
+				output = argv[++i];
+			}
+			else
+			{
+				throw std::runtime_error("Unrecognized option: " + option + "\n" + usage);
+			}
+		}
+	}
+};
+
+const std::string bench_options::usage =
+	"Usage: bench [--raid-times MIN-MAX] [--players N,N,...] [--distribution NAME]\n"
+	"             [--budget-ms MS] [--seed S] [--output FILE]\n"
+	"       bench --generate PLAYERS RAID_TIMES DISTRIBUTION [SEED]\n"
+	"Distributions: uniform, evening, timezones, duplicates\n";
+
+struct bench_case_result
+{
+	std::string engine;
+	std::string distribution;
+	unsigned int players = 0;
+	unsigned int raid_times = 0;
+	double parse_lines_per_second = 0;
+	double enumerate_candidates_per_second = 0;
+	double score_candidates_per_second = 0;
+	unsigned long long candidates_scored = 0;
+	bool all_candidates_scored = false;
+	long long best_value = 0;
+	double speedup = 1;
+};
+
+const double engine_budget_factor = 10;
+
+volatile unsigned int enumeration_sink = 0;
+
+double seconds_since(search_clock::time_point start)
+{
+	return std::chrono::duration<double>(search_clock::now() - start).count();
+}
+
+void parse_roster(const std::string& text, config_header_parser& header, roster& players)
+{
+	std::istringstream stream(text);
+	std::string line;
+	while (header.parsed() == false && std::getline(stream, line).good())
+	{
+		if (is_comment(line))
+		{
+			continue;
+		}
+		header.parse(line);
+	}
+	while (std::getline(stream, line).good())
+	{
+		if (is_comment(line))
+		{
+			continue;
+		}
+		players.add(player_parser(line, header));
+	}
+}
+
+void run_case(const roster_generator_options& roster_options, const std::chrono::duration<double>& budget, std::vector<bench_case_result>& results)
+{
+	bench_case_result result;
+	result.engine = "reference";
+	result.distribution = roster_generator_options::distribution_name(roster_options.distribution);
+	result.players = roster_options.players;
+	result.raid_times = roster_options.raid_times;
+
+	std::ostringstream generated;
+	roster_generator(roster_options).generate(generated);
+	const std::string text = generated.str();
+
+	config_header_parser header;
+	roster players;
+	{
+		unsigned long long lines_parsed = 0;
+		const auto start = search_clock::now();
+		do
+		{
+			header = config_header_parser();
+			players.clear();
+			parse_roster(text, header, players);
+			lines_parsed += players.size() + 4;
+		}
+		while (seconds_since(start) < budget.count());
+		result.parse_lines_per_second = lines_parsed / seconds_since(start);
+	}
+
+	const unsigned int raid_times = header.number_of_raid_times;
+	const auto values = build_value_lookup_table(header);
+	const unsigned long long clock_check_interval = std::max<unsigned long long>(1, 65536 / (players.size() + 1));
+
+	{
+		unsigned long long candidates = 0;
+		unsigned int checksum = 0;
+		const auto start = search_clock::now();
+		do
+		{
+			auto it = all_solutions_iterator::begin(raid_times);
+			const auto end = all_solutions_iterator::end(raid_times);
+			for (; it != end; ++it)
+			{
+				checksum ^= (*it).get_data();
+				++candidates;
+			}
+		}
+		while (seconds_since(start) < budget.count());
+		result.enumerate_candidates_per_second = candidates / seconds_since(start);
+		// Keeps enumeration from being optimized away
+		enumeration_sink = checksum;
+	}
+
+	{
+		long long best_value = std::numeric_limits<long long>::min();
+		unsigned long long candidates = 0;
+		const auto start = search_clock::now();
+		auto it = all_solutions_iterator::begin(raid_times);
+		const auto end = all_solutions_iterator::end(raid_times);
+		for (; it != end; ++it)
+		{
+			best_value = std::max(best_value, solution_value(*it, players, values));
+			++candidates;
+			if (candidates % clock_check_interval == 0 && seconds_since(start) >= budget.count())
+			{
+				break;
+			}
+		}
+		result.score_candidates_per_second = candidates / seconds_since(start);
+		result.candidates_scored = candidates;
+		result.all_candidates_scored = candidates == number_of_combinations(24, raid_times);
+		result.best_value = best_value;
+	}
+	results.push_back(result);
+
+	const unsigned long long all_candidates = number_of_combinations(24, raid_times);
+	if (all_candidates / result.score_candidates_per_second > engine_budget_factor * budget.count())
+	{
+		return;
+	}
+	std::vector<scored_solution> solutions;
+	for (size_t i = 0; i < number_of_solver_engines; ++i)
+	{
+		bench_case_result engine_result = result;
+		engine_result.engine = solver_engines[i].name;
+		const auto start = search_clock::now();
+		solver_engines[i].solve(header, players, max_solutions_to_present, solutions);
+		engine_result.score_candidates_per_second = all_candidates / seconds_since(start);
+		engine_result.candidates_scored = all_candidates;
+		engine_result.all_candidates_scored = true;
+		engine_result.best_value = solutions.front().first;
+		engine_result.speedup = engine_result.score_candidates_per_second / result.score_candidates_per_second;
+		results.push_back(engine_result);
+	}
+}
+
+void out(std::ostream& stream, const bench_options& options, const std::vector<bench_case_result>& results)
+{
+	stream << "{\n\"benchmark\": \"raid_start_times\",\n\"budget_ms\": " << options.budget_ms <<
+		",\n\"seed\": " << options.seed << ",\n\"results\": [\n";
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const auto& r = results[i];
+		stream << "  {\"engine\": \"" << r.engine << "\", \"distribution\": \"" << r.distribution <<
+			"\", \"players\": " << r.players << ", \"raid_times\": " << r.raid_times <<
+			", \"parse_lines_per_s\": " << r.parse_lines_per_second <<
+			", \"enumerate_candidates_per_s\": " << r.enumerate_candidates_per_second <<
+			", \"score_candidates_per_s\": " << r.score_candidates_per_second <<
+			", \"score_player_evaluations_per_s\": " << r.score_candidates_per_second * r.players <<
+			", \"candidates_scored\": " << r.candidates_scored <<
+			", \"all_candidates_scored\": " << (r.all_candidates_scored ? "true" : "false") <<
+			", \"best_value\": " << r.best_value << ", \"speedup\": " << r.speedup << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	stream << "]\n}\n";
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		if (argc > 1 && std::string(argv[1]) == "--generate")
+		{
+			if (argc < 5 || argc > 6)
+			{
+				throw std::runtime_error(bench_options::usage);
+			}
+			roster_generator_options roster_options;
+			roster_options.players = parse_unsigned("players", argv[2]);
+			roster_options.raid_times = parse_unsigned("raid times", argv[3]);
+			if (!roster_generator_options::is_valid_raid_times(roster_options.raid_times))
+			{
+				throw std::runtime_error("Invalid number of raid times: " + std::string(argv[3]) + "\n" + bench_options::usage);
+			}
+			roster_options.distribution = roster_generator_options::parse_distribution(argv[4]);
+			if (argc == 6)
+			{
+				roster_options.seed = parse_unsigned("seed", argv[5]);
+			}
+			roster_generator(roster_options).generate(std::cout);
+			return 0;
+		}
+
+		bench_options options;
+		options.parse(argc, argv);
+		const std::chrono::duration<double> budget(options.budget_ms / 1000.0);
+
+		std::vector<bench_case_result> results;
+		for (const auto distribution : options.distributions)
+		{
+			for (const auto players : options.players)
+			{
+				for (unsigned int raid_times = options.min_raid_times; raid_times <= options.max_raid_times; ++raid_times)
+				{
+					roster_generator_options roster_options;
+					roster_options.players = players;
+					roster_options.raid_times = raid_times;
+					roster_options.distribution = distribution;
+					roster_options.seed = options.seed;
+					const size_t first_result = results.size();
+					run_case(roster_options, budget, results);
+					for (size_t i = first_result; i < results.size(); ++i)
+					{
+						std::cerr << roster_generator_options::distribution_name(distribution) << " players: " << players <<
+							" raid times: " << raid_times << " engine: " << results[i].engine <<
+							" scored candidates/s: " << results[i].score_candidates_per_second << "\n";
+					}
+				}
+			}
+		}
+
+		if (options.output.empty())
+		{
+			out(std::cout, options, results);
+		}
+		else
+		{
+			std::ofstream file(options.output);
+			out(file, options, results);
+			if (!file)
+			{
+				throw std::runtime_error("Failed writing " + options.output);
+			}
+		}
+	}
+	catch (parse_error& e)
+	{
+		std::cerr << "Generated roster could not be parsed: " << e.what() << "\n";
+		return 1;
+	}
+	catch (std::runtime_error& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
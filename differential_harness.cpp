@@ -0,0 +1,975 @@
+/* Differential harness of solver engines
+ *
+ * Build (from repository root):
+ *   g++ -std=c++11 -O2 differential_harness.cpp raid_solver.cpp -o differential_harness
+ *
+ * Usage:
+ *   differential_harness [--cases N] [--seed S] [--max-players N]
+ *                        [--max-raid-times K] [--output FILE] [--dump]
+ *
+ * Generates random inputs (headers and rosters in the format of input.txt)
+ * and runs every registered engine alongside the reference calculation of
+ * raid_start_times: all_solutions_iterator, solution_value and multimap. Best
+ * top solutions of each engine must be the same as the first ones of the
+ * reference, values, hours and order of ties included. Inputs include edge
+ * cases: empty best lists, hours both in best and acceptable list (which
+ * player_parser strips), weight lists shorter than number of raid times,
+ * negative weights, identical preferences and 1, 2, 22 or 23 raid times in
+ * every fourth case. Other cases have at most max raid times, as the reference
+ * keeps all solutions in memory. Another fourth of cases also checks joint
+ * search of 2 or 3 raids with 1 to 3 raid times, half of them with flat
+ * weights, with and without shared hours, against every combination of
+ * reference solutions of the raids. Every third of those has identical raids
+ * with up to 8 (2 raids) or 5 (3 raids) raid times, whose search must also
+ * finish within identical_joint_time_limit_ms. Leave-one-out impact is
+ * checked in another fourth of cases and on fixed input whose optimum stays
+ * tied when a player is removed, against reference results of roster without
+ * each player. The last
+ * fourth checks weekly calendar of 1 to 3 raid times against every
+ * combination of slots of the week.
+ *
+ * Case i is generated from seed S + i, so it can be reproduced alone with
+ * --seed S+i --cases 1, --dump prints its input. Per engine results with
+ * speedup over the reference are written as JSON, exit status is 1 when any
+ * engine differs from the reference.
+ */
+
+#include "raid_solver.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+
+typedef std::chrono::steady_clock search_clock;
+
+struct harness_options
+{
+	unsigned int cases = 200;
+	unsigned int seed = 1;
+	unsigned int max_players = 40;
+	unsigned int max_raid_times = 8;
+	std::string output;
+	bool dump = false;
+
+	static const std::string usage;
+
+	void parse(int argc, char* argv[])
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string option = argv[i];
+			if (option == "--cases" && i + 1 < argc)
+			{
+				cases = parse_unsigned(option, argv[++i]);
+			}
+			else if (option == "--seed" && i + 1 < argc)
+			{
+				seed = parse_unsigned(option, argv[++i]);
+			}
+			else if (option == "--max-players" && i + 1 < argc)
+			{
+				max_players = parse_unsigned(option, argv[++i]);
+			}
+			else if (option == "--max-raid-times" && i + 1 < argc)
+			{
+				max_raid_times = parse_unsigned(option, argv[++i]);
+				if (max_raid_times < 1 || max_raid_times > 23)
+				{
+					throw std::runtime_error("Invalid number of raid times: " + std::string(argv[i]) + "\n" + usage);
+				}
+			}
+			else if (option == "--output" && i + 1 < argc)
+			{
+				output = argv[++i];
+			}
+			else if (option == "--dump")
+			{
+				dump = true;
+			}
+			else
+			{
+				throw std::runtime_error("Unrecognized option: " + option + "\n" + usage);
+			}
+		}
+	}
+};
+
+const std::string harness_options::usage =
+	"Usage: differential_harness [--cases N] [--seed S] [--max-players N]\n"
+	"                            [--max-raid-times K] [--output FILE] [--dump]\n";
+
+/*****************************************************************************/
+// Random inputs
+//
+// Only std::mt19937 output is used, as in roster_generator, so the same seed
+// gives the same input everywhere.
+
+class case_generator
+{
+public:
+	case_generator(const harness_options& o, unsigned int seed) :
+		options(o),
+		random(seed)
+	{
+	}
+
+	std::string generate(bool edge_raid_times)
+	{
+		static const unsigned int edge_raid_times_values[] = {1, 2, 22, 23};
+		const unsigned int raid_times = edge_raid_times ? edge_raid_times_values[next(4)] : 1 + next(options.max_raid_times);
+
+		std::ostringstream stream;
+		stream << "Number of best raid times to seek: " << raid_times << "\n";
+		stream << "Guild activities reset time for results: " << next(24) << ":30\n";
+		stream << "Best times weights list: " << weights(raid_times) << "\n";
+		stream << "Acceptable times weights list: " << weights(raid_times) << "\n";
+		members(stream);
+		return stream.str();
+	}
+
+	/* Headers of 2 or 3 raids with few raid times, so that all combinations of
+	 * their solutions can be searched, flat weights give many ties
+	 */
+	std::string generate_joint()
+	{
+		const unsigned int raids = 2 + next(2);
+		std::ostringstream stream;
+		for (unsigned int i = 0; i < raids; ++i)
+		{
+			const unsigned int raid_times = 1 + next(raids == 2 ? 3 : 2);
+			const bool flat = next(2) == 0;
+			stream << "Number of best raid times to seek: " << raid_times << "\n";
+			stream << "Guild activities reset time for results: " << next(24) << ":30\n";
+			stream << "Best times weights list: " << (flat ? "1" : weights(raid_times)) << "\n";
+			stream << "Acceptable times weights list: " << (flat ? "1" : weights(raid_times)) << "\n";
+		}
+		members(stream);
+		return stream.str();
+	}
+
+	/* Headers of 2 raids with 4 to 8 raid times or 3 raids with 3 to 5 raid
+	 * times, which differ only by reset hour and sometimes by weight beyond the
+	 * number of raid times, so all raids have the same solutions
+	 */
+	std::string generate_identical_joint()
+	{
+		const unsigned int raids = 2 + next(2);
+		const unsigned int raid_times = raids == 2 ? 4 + next(5) : 3 + next(3);
+		const bool flat = next(2) == 0;
+		const std::string best_weights = flat ? "1" : weights(raid_times);
+		const std::string acceptable_weights = flat ? "1" : weights(raid_times);
+		const bool all_weights_given = std::count(best_weights.begin(), best_weights.end(), ',') + 1 >= raid_times;
+		std::ostringstream stream;
+		for (unsigned int i = 0; i < raids; ++i)
+		{
+			stream << "Number of best raid times to seek: " << raid_times << "\n";
+			stream << "Guild activities reset time for results: " << next(24) << ":30\n";
+			stream << "Best times weights list: " << best_weights << (i > 0 && all_weights_given && next(2) == 0 ? ", 7" : "") << "\n";
+			stream << "Acceptable times weights list: " << acceptable_weights << "\n";
+		}
+		members(stream);
+		return stream.str();
+	}
+
+	/* Single raid with 1 to 3 raid times, so that all solutions of the week
+	 * can be scored, players with weekday qualified lists or daily ones
+	 */
+	std::string generate_week()
+	{
+		const unsigned int raid_times = 1 + next(3);
+		std::ostringstream stream;
+		stream << "Number of best raid times to seek: " << raid_times << "\n";
+		stream << "Guild activities reset time for results: " << next(24) << ":30\n";
+		stream << "Best times weights list: " << weights(raid_times) << "\n";
+		stream << "Acceptable times weights list: " << weights(raid_times) << "\n";
+		const unsigned int players = 1 + next(options.max_players);
+		std::string previous;
+		for (unsigned int i = 0; i < players; ++i)
+		{
+			stream << "Player " << i + 1 << ", ";
+			if (!previous.empty() && next(4) == 0)
+			{
+				stream << previous << "\n";
+				continue;
+			}
+			// The first player has weekday qualified list, so the week is searched
+			const bool weekly_best = i == 0 || next(2) == 0;
+			const bool weekly_acceptable = next(2) == 0;
+			previous = "reset(" + std::to_string(next(24)) + ":30), " +
+				(weekly_best ? week_list("best") : list("best", hours(6))) + ", " +
+				(weekly_acceptable ? week_list("acceptable") : list("acceptable", hours(6)));
+			stream << previous << "\n";
+		}
+		return stream.str();
+	}
+
+	/* Single raid with 1 or 2 raid times, so every player can be removed in
+	 * turn, flat weights make removed player often leave the optimum tied
+	 */
+	std::string generate_impact()
+	{
+		const unsigned int raid_times = 1 + next(2);
+		const bool flat = next(2) == 0;
+		std::ostringstream stream;
+		stream << "Number of best raid times to seek: " << raid_times << "\n";
+		stream << "Guild activities reset time for results: " << next(24) << ":30\n";
+		stream << "Best times weights list: " << (flat ? "1" : weights(raid_times)) << "\n";
+		stream << "Acceptable times weights list: " << (flat ? "1" : weights(raid_times)) << "\n";
+		members(stream);
+		return stream.str();
+	}
+
+private:
+	const harness_options& options;
+	std::mt19937 random;
+
+	void members(std::ostream& stream)
+	{
+		const unsigned int players = next(options.max_players + 1);
+		std::string previous;
+		for (unsigned int i = 0; i < players; ++i)
+		{
+			stream << "Player " << i + 1 << ", ";
+			// Identical preferences, scored once by some engines
+			if (!previous.empty() && next(4) == 0)
+			{
+				stream << previous << "\n";
+				continue;
+			}
+			std::vector<unsigned int> best;
+			std::vector<unsigned int> acceptable;
+			switch (next(4))
+			{
+			case 0:
+				// Nothing best, only acceptable hours
+				acceptable = hours(4);
+				break;
+			case 1:
+				// Overlapping lists, common hours are removed from acceptable
+				best = hours(4);
+				acceptable = hours(4);
+				acceptable.insert(acceptable.end(), best.begin(), best.end());
+				break;
+			case 2:
+				// Evening block
+				for (unsigned int hour = 17 + next(4), length = 1 + next(6); length > 0; --length, ++hour)
+				{
+					(next(3) ? best : acceptable).push_back(hour % 24);
+				}
+				break;
+			default:
+				best = hours(8);
+				acceptable = hours(8);
+				break;
+			}
+			previous = "reset(" + std::to_string(next(24)) + ":30), " + list("best", best) + ", " + list("acceptable", acceptable);
+			stream << previous << "\n";
+		}
+	}
+
+	unsigned int next(unsigned int limit)
+	{
+		return random() % limit;
+	}
+
+	/* Often shorter than number of raid times, last weight is then repeated */
+	std::string weights(unsigned int raid_times)
+	{
+		static const int typical[] = {10000, 1000, 100, 10, 1, 0};
+		std::string retval;
+		for (unsigned int length = 1 + next(raid_times + 1); length > 0; --length)
+		{
+			const unsigned int draw = next(8);
+			const int weight = draw == 0 ? -static_cast<int>(next(100)) : draw < 4 ? typical[next(6)] : static_cast<int>(next(20000));
+			retval += (retval.empty() ? "" : ", ") + std::to_string(weight);
+		}
+		return retval;
+	}
+
+	/* Each hour with probability 1/one_in */
+	std::vector<unsigned int> hours(unsigned int one_in)
+	{
+		std::vector<unsigned int> retval;
+		for (unsigned int hour = 0; hour < 24; ++hour)
+		{
+			if (next(one_in) == 0)
+			{
+				retval.push_back(hour);
+			}
+		}
+		return retval;
+	}
+
+	/* Groups of days (single day or range, which may wrap over the end of the
+	 * week) with their hours, e.g. best(Sat:14,15;Mon-Fri:19)
+	 */
+	std::string week_list(const std::string& name)
+	{
+		std::string retval = name + "(";
+		for (unsigned int groups = 1 + next(3); groups > 0; --groups)
+		{
+			std::vector<unsigned int> group_hours = hours(8);
+			if (group_hours.empty())
+			{
+				group_hours.push_back(next(24));
+			}
+			retval += std::string(day_names[next(7)]);
+			if (next(2) == 0)
+			{
+				retval += "-" + std::string(day_names[next(7)]);
+			}
+			retval += ":";
+			for (size_t i = 0; i < group_hours.size(); ++i)
+			{
+				retval += (i ? "," : "") + std::to_string(group_hours[i]);
+			}
+			retval += groups > 1 ? ";" : "";
+		}
+		return retval + ")";
+	}
+
+	static std::string list(const std::string& name, const std::vector<unsigned int>& hours)
+	{
+		std::string retval = name + "(";
+		for (size_t i = 0; i < hours.size(); ++i)
+		{
+			retval += (i ? "," : "") + std::to_string(hours[i]);
+		}
+		return retval + ")";
+	}
+};
+
+/*****************************************************************************/
+// Comparison with the reference
+
+struct harness_case_result
+{
+	unsigned int case_seed = 0;
+	std::string engine;
+	size_t players = 0;
+	unsigned int raid_times = 0;
+	size_t top = 0;
+	bool matches = true;
+	// Rank of the first solution which differs, -1 when all match
+	long long first_mismatch = -1;
+	double reference_ms = 0;
+	double engine_ms = 0;
+	double speedup = 1;
+};
+
+double milliseconds_since(search_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(search_clock::now() - start).count();
+}
+
+/* Skipped player is left out of the roster */
+void parse_input(const std::string& text, config_header_parser& header, roster& players, size_t skipped_player = std::string::npos)
+{
+	std::istringstream stream(text);
+	std::string line;
+	while (header.parsed() == false && std::getline(stream, line).good())
+	{
+		header.parse(line);
+	}
+	for (size_t player = 0; std::getline(stream, line).good(); ++player)
+	{
+		if (player != skipped_player)
+		{
+			players.add(player_parser(line, header));
+		}
+	}
+}
+
+/* The same calculation as calculate_results of raid_start_times */
+std::vector<scored_solution> reference_results(const config_header& header, const roster& players, size_t top)
+{
+	const auto values = build_value_lookup_table(header);
+	std::multimap<long long, time_bitmap, std::greater<long long> > results;
+	auto it = all_solutions_iterator::begin(header.number_of_raid_times);
+	const auto end = all_solutions_iterator::end(header.number_of_raid_times);
+	for (; it != end; ++it)
+	{
+		results.insert(std::make_pair(solution_value(*it, players, values), *it));
+	}
+	std::vector<scored_solution> retval;
+	for (auto sol = results.begin(); sol != results.end() && retval.size() < top; ++sol)
+	{
+		retval.push_back(*sol);
+	}
+	return retval;
+}
+
+long long first_mismatch(const std::vector<scored_solution>& expected, const std::vector<scored_solution>& actual)
+{
+	for (size_t i = 0; i < std::max(expected.size(), actual.size()); ++i)
+	{
+		if (i >= expected.size() || i >= actual.size() || expected[i].first != actual[i].first ||
+				expected[i].second.get_data() != actual[i].second.get_data())
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+void out_solution(std::ostream& stream, const std::vector<scored_solution>& solutions, size_t rank)
+{
+	if (rank >= solutions.size())
+	{
+		stream << "none";
+		return;
+	}
+	stream << solutions[rank].first << ":";
+	for (unsigned int hour = 0; hour < 24; ++hour)
+	{
+		if (solutions[rank].second.is_set(hour))
+		{
+			stream << " " << hour;
+		}
+	}
+}
+
+void run_case(const harness_options& options, unsigned int case_seed, bool edge_raid_times, std::vector<harness_case_result>& results)
+{
+	case_generator generator(options, case_seed);
+	const std::string text = generator.generate(edge_raid_times);
+	if (options.dump)
+	{
+		std::cout << text;
+	}
+
+	config_header_parser header;
+	roster players;
+	parse_input(text, header, players);
+
+	static const size_t tops[] = {1, 2, 10, 100, max_solutions_to_present};
+	const size_t top = tops[case_seed % (sizeof(tops) / sizeof(tops[0]))];
+
+	const auto reference_start = search_clock::now();
+	const auto expected = reference_results(header, players, top);
+	const double reference_ms = milliseconds_since(reference_start);
+
+	std::vector<scored_solution> actual;
+	for (size_t i = 0; i < number_of_solver_engines; ++i)
+	{
+		harness_case_result result;
+		result.case_seed = case_seed;
+		result.engine = solver_engines[i].name;
+		result.players = players.size();
+		result.raid_times = header.number_of_raid_times;
+		result.top = top;
+		result.reference_ms = reference_ms;
+
+		const auto start = search_clock::now();
+		solver_engines[i].solve(header, players, top, actual);
+		result.engine_ms = milliseconds_since(start);
+		result.speedup = result.engine_ms > 0 ? reference_ms / result.engine_ms : 1;
+		result.first_mismatch = first_mismatch(expected, actual);
+		result.matches = result.first_mismatch < 0;
+		if (!result.matches)
+		{
+			std::cerr << "Engine " << result.engine << " differs from reference in case with seed " << case_seed <<
+				" at rank " << result.first_mismatch + 1 << ", expected ";
+			out_solution(std::cerr, expected, result.first_mismatch);
+			std::cerr << ", got ";
+			out_solution(std::cerr, actual, result.first_mismatch);
+			std::cerr << "\n";
+		}
+		results.push_back(result);
+	}
+}
+
+/* Headers of all raids are before members */
+void parse_joint_input(const std::string& text, std::vector<config_header>& headers, roster& players)
+{
+	std::istringstream stream(text);
+	std::string line;
+	config_header_parser header;
+	while (std::getline(stream, line).good())
+	{
+		if (header.parsed() && !config_header_parser::is_header_line(line))
+		{
+			players.add(player_parser(line, headers.front()));
+			continue;
+		}
+		if (header.parsed())
+		{
+			header = config_header_parser();
+		}
+		header.parse(line);
+		if (header.parsed())
+		{
+			headers.push_back(header);
+		}
+	}
+}
+
+/* Every combination of solutions of raids given by the reference, solutions
+ * of each raid are sorted by value, so the rest of them is skipped once even
+ * the best solutions of following raids can't reach the presented ones
+ */
+std::vector<joint_solution> reference_joint_results(const std::vector<config_header>& headers, const roster& players, bool shared_hours, size_t top)
+{
+	std::vector<std::vector<scored_solution> > solutions;
+	for (const auto& header : headers)
+	{
+		solutions.push_back(reference_results(header, players, number_of_combinations(24, header.number_of_raid_times)));
+	}
+	std::vector<long long> best_of_following(headers.size(), 0);
+	for (size_t raid = headers.size() - 1; raid-- > 0;)
+	{
+		best_of_following[raid] = best_of_following[raid + 1] + solutions[raid + 1].front().first;
+	}
+	// Heap with the last presented one on top
+	std::vector<joint_solution> best;
+	joint_solution current;
+	current.value = 0;
+	current.raids.resize(headers.size());
+	std::function<void(size_t, unsigned int)> combine = [&] (size_t raid, unsigned int used_hours)
+	{
+		if (raid == headers.size())
+		{
+			if (best.size() < top || is_joint_presented_before(current, best.front()))
+			{
+				if (best.size() == top)
+				{
+					std::pop_heap(best.begin(), best.end(), is_joint_presented_before);
+					best.pop_back();
+				}
+				best.push_back(current);
+				std::push_heap(best.begin(), best.end(), is_joint_presented_before);
+			}
+			return;
+		}
+		for (const auto& sol : solutions[raid])
+		{
+			if (best.size() == top && current.value + sol.first + best_of_following[raid] < best.front().value)
+			{
+				break;
+			}
+			const unsigned int hours = sol.second.get_data();
+			if (!shared_hours && (hours & used_hours))
+			{
+				continue;
+			}
+			current.raids[raid] = sol;
+			current.value += sol.first;
+			combine(raid + 1, used_hours | hours);
+			current.value -= sol.first;
+		}
+	};
+	combine(0, 0);
+	std::sort_heap(best.begin(), best.end(), is_joint_presented_before);
+	return best;
+}
+
+long long first_joint_mismatch(const std::vector<joint_solution>& expected, const std::vector<joint_solution>& actual)
+{
+	for (size_t i = 0; i < std::max(expected.size(), actual.size()); ++i)
+	{
+		if (i >= expected.size() || i >= actual.size() || expected[i].value != actual[i].value ||
+				first_mismatch(expected[i].raids, actual[i].raids) >= 0)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+void out_joint_solution(std::ostream& stream, const std::vector<joint_solution>& solutions, size_t rank)
+{
+	if (rank >= solutions.size())
+	{
+		stream << "none";
+		return;
+	}
+	stream << solutions[rank].value << " =";
+	for (size_t raid = 0; raid < solutions[rank].raids.size(); ++raid)
+	{
+		stream << (raid ? " +" : "") << " ";
+		out_solution(stream, solutions[rank].raids, raid);
+	}
+}
+
+/* Joint search of identical raids must not explore every order of their
+ * solutions, with many raid times that would take far longer
+ */
+const double identical_joint_time_limit_ms = 2000;
+
+/* Joint cases come every fourth case, so variants are chosen by case_seed / 4 */
+void run_joint_case(const harness_options& options, unsigned int case_seed, std::vector<harness_case_result>& results)
+{
+	const unsigned int joint_case = case_seed / 4;
+	const bool identical = joint_case % 3 == 2;
+	case_generator generator(options, case_seed);
+	const std::string text = identical ? generator.generate_identical_joint() : generator.generate_joint();
+	if (options.dump)
+	{
+		std::cout << text;
+	}
+
+	std::vector<config_header> headers;
+	roster players;
+	parse_joint_input(text, headers, players);
+	const bool shared_hours = joint_case % 2 == 0;
+
+	static const size_t tops[] = {1, 2, 10, max_solutions_to_present};
+	const size_t top = tops[joint_case / 2 % (sizeof(tops) / sizeof(tops[0]))];
+
+	harness_case_result result;
+	result.case_seed = case_seed;
+	result.engine = std::string(identical ? "joint_identical" : "joint") + (shared_hours ? "" : "_no_shared_hours");
+	result.players = players.size();
+	result.top = top;
+	for (const auto& header : headers)
+	{
+		result.raid_times += header.number_of_raid_times;
+	}
+
+	const auto reference_start = search_clock::now();
+	const auto expected = reference_joint_results(headers, players, shared_hours, top);
+	result.reference_ms = milliseconds_since(reference_start);
+
+	std::vector<joint_solution> actual;
+	const auto start = search_clock::now();
+	solve_joint(headers, players, shared_hours, top, actual);
+	result.engine_ms = milliseconds_since(start);
+	result.speedup = result.engine_ms > 0 ? result.reference_ms / result.engine_ms : 1;
+	result.first_mismatch = first_joint_mismatch(expected, actual);
+	result.matches = result.first_mismatch < 0;
+	if (!result.matches)
+	{
+		std::cerr << "Joint search of " << headers.size() << " raids differs from reference in case with seed " << case_seed <<
+			" at rank " << result.first_mismatch + 1 << ", expected ";
+		out_joint_solution(std::cerr, expected, result.first_mismatch);
+		std::cerr << ", got ";
+		out_joint_solution(std::cerr, actual, result.first_mismatch);
+		std::cerr << "\n";
+	}
+	if (identical && result.engine_ms > identical_joint_time_limit_ms)
+	{
+		std::cerr << "Joint search of " << headers.size() << " identical raids took " << result.engine_ms <<
+			" ms in case with seed " << case_seed << ", limit is " << identical_joint_time_limit_ms << " ms\n";
+		result.matches = false;
+	}
+	results.push_back(result);
+}
+
+/* Every combination of raid_times slots of the week in enumeration order,
+ * of those which differ only by slots every player likes the same (slots of
+ * the same class) the first one is kept, with number of such solutions.
+ */
+std::vector<week_solution> reference_week_results(const config_header& header, const roster& players, size_t top)
+{
+	const auto values = build_value_lookup_table(header);
+	const unsigned int raid_times = header.number_of_raid_times;
+
+	// Preference of each player for each slot: 0 none, 1 best, 2 acceptable
+	std::vector<std::vector<unsigned char> > preferences(hours_in_week, std::vector<unsigned char>(players.size(), 0));
+	for (unsigned int slot = 0; slot < hours_in_week; ++slot)
+	{
+		for (size_t i = 0; i < players.size(); ++i)
+		{
+			preferences[slot][i] = players.best_week(i).test(slot) ? 1 : players.acceptable_week(i).test(slot) ? 2 : 0;
+		}
+	}
+	std::map<std::vector<unsigned char>, unsigned int> class_of_preferences;
+	std::vector<unsigned int> slot_class(hours_in_week);
+	std::vector<unsigned int> rank_in_class(hours_in_week);
+	std::vector<unsigned int> class_size;
+	for (unsigned int slot = 0; slot < hours_in_week; ++slot)
+	{
+		const auto found = class_of_preferences.insert(std::make_pair(preferences[slot], class_size.size())).first;
+		if (found->second == class_size.size())
+		{
+			class_size.push_back(0);
+		}
+		slot_class[slot] = found->second;
+		rank_in_class[slot] = class_size[found->second]++;
+	}
+
+	std::vector<week_solution> retval;
+	std::vector<unsigned int> slots(raid_times);
+	std::function<void(unsigned int, unsigned int)> combine = [&] (unsigned int position, unsigned int first_slot)
+	{
+		if (position == raid_times)
+		{
+			week_solution sol;
+			sol.value = 0;
+			sol.equivalent = 1;
+			std::map<unsigned int, unsigned int> taken;
+			for (const auto slot : slots)
+			{
+				sol.slots.set(slot);
+				++taken[slot_class[slot]];
+			}
+			// Only the first slots of each class, in the order of the week
+			for (const auto slot : slots)
+			{
+				if (rank_in_class[slot] >= taken[slot_class[slot]])
+				{
+					return;
+				}
+			}
+			for (const auto& t : taken)
+			{
+				sol.equivalent *= number_of_combinations(class_size[t.first], t.second);
+			}
+			for (size_t i = 0; i < players.size(); ++i)
+			{
+				unsigned int best_times = 0;
+				unsigned int acceptable_times = 0;
+				for (const auto slot : slots)
+				{
+					best_times += preferences[slot][i] == 1;
+					acceptable_times += preferences[slot][i] == 2;
+				}
+				sol.value += single_player_value(values, best_times, acceptable_times);
+			}
+			retval.push_back(sol);
+			return;
+		}
+		for (unsigned int slot = first_slot; slot + raid_times - position <= hours_in_week; ++slot)
+		{
+			slots[position] = slot;
+			combine(position + 1, slot + 1);
+		}
+	};
+	combine(0, 0);
+	// Solutions were generated in enumeration order
+	std::stable_sort(retval.begin(), retval.end(), [] (const week_solution& first, const week_solution& second)
+	{
+		return first.value > second.value;
+	});
+	retval.resize(std::min(retval.size(), top));
+	return retval;
+}
+
+long long first_week_mismatch(const std::vector<week_solution>& expected, const std::vector<week_solution>& actual)
+{
+	for (size_t i = 0; i < std::max(expected.size(), actual.size()); ++i)
+	{
+		if (i >= expected.size() || i >= actual.size() || expected[i].value != actual[i].value ||
+				expected[i].slots != actual[i].slots || expected[i].equivalent != actual[i].equivalent)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+void out_week_solution(std::ostream& stream, const std::vector<week_solution>& solutions, size_t rank)
+{
+	if (rank >= solutions.size())
+	{
+		stream << "none";
+		return;
+	}
+	stream << solutions[rank].value << ":";
+	for (unsigned int slot = 0; slot < hours_in_week; ++slot)
+	{
+		if (solutions[rank].slots.test(slot))
+		{
+			stream << " " << week_slot_label(slot);
+		}
+	}
+	stream << " (" << solutions[rank].equivalent << " equivalent)";
+}
+
+void run_week_case(const harness_options& options, unsigned int case_seed, std::vector<harness_case_result>& results)
+{
+	case_generator generator(options, case_seed);
+	const std::string text = generator.generate_week();
+	if (options.dump)
+	{
+		std::cout << text;
+	}
+
+	config_header_parser header;
+	roster players;
+	parse_input(text, header, players);
+
+	static const size_t tops[] = {1, 2, 10, max_solutions_to_present};
+	const size_t top = tops[case_seed % (sizeof(tops) / sizeof(tops[0]))];
+
+	harness_case_result result;
+	result.case_seed = case_seed;
+	result.engine = "week";
+	result.players = players.size();
+	result.raid_times = header.number_of_raid_times;
+	result.top = top;
+
+	const auto reference_start = search_clock::now();
+	const auto expected = reference_week_results(header, players, top);
+	result.reference_ms = milliseconds_since(reference_start);
+
+	std::vector<week_solution> actual;
+	const auto start = search_clock::now();
+	week_solver(header, players).solve(top, actual);
+	result.engine_ms = milliseconds_since(start);
+	result.speedup = result.engine_ms > 0 ? result.reference_ms / result.engine_ms : 1;
+	result.first_mismatch = first_week_mismatch(expected, actual);
+	result.matches = result.first_mismatch < 0;
+	if (!result.matches)
+	{
+		std::cerr << "Weekly calendar differs from reference in case with seed " << case_seed <<
+			" at rank " << result.first_mismatch + 1 << ", expected ";
+		out_week_solution(std::cerr, expected, result.first_mismatch);
+		std::cerr << ", got ";
+		out_week_solution(std::cerr, actual, result.first_mismatch);
+		std::cerr << "\n";
+	}
+	results.push_back(result);
+}
+
+/* Optimum of all players is 20, without P2 or P3 hour 5 ties it and comes
+ * first, so the old optimum is kept and impact shall not report a change
+ */
+const std::string tied_optimum_input =
+	"Number of best raid times to seek: 1\n"
+	"Guild activities reset time for results: 18:30\n"
+	"Best times weights list: 10\n"
+	"Acceptable times weights list: 1\n"
+	"P1, reset(18:30), best(5)\n"
+	"P2, reset(18:30), best(20)\n"
+	"P3, reset(18:30), best(20)\n";
+
+/* Leave-one-out impact against reference results of roster without each
+ * player in turn, mismatch rank is index of the first player which differs
+ */
+void run_impact_case(unsigned int case_seed, const std::string& text, std::vector<harness_case_result>& results)
+{
+	config_header_parser header;
+	roster players;
+	parse_input(text, header, players);
+	const auto values = build_value_lookup_table(header);
+
+	harness_case_result result;
+	result.case_seed = case_seed;
+	result.engine = "impact";
+	result.players = players.size();
+	result.raid_times = header.number_of_raid_times;
+	result.top = 1;
+
+	std::vector<player_impact> impacts;
+	const auto start = search_clock::now();
+	const scored_solution optimum = leave_one_out_impact(header, players, impacts);
+	result.engine_ms = milliseconds_since(start);
+
+	const auto reference_start = search_clock::now();
+	const auto expected_optimum = reference_results(header, players, 1);
+	if (first_mismatch(expected_optimum, std::vector<scored_solution>(1, optimum)) >= 0)
+	{
+		result.first_mismatch = 0;
+	}
+	for (size_t i = 0; i < players.size() && result.first_mismatch < 0; ++i)
+	{
+		config_header_parser header_without;
+		roster without;
+		parse_input(text, header_without, without, i);
+		const auto expected = reference_results(header_without, without, 1);
+		const long long old_optimum_value = solution_value(expected_optimum.front().second, without, values);
+		if (first_mismatch(expected, std::vector<scored_solution>(1, impacts[i].optimum_without)) >= 0 ||
+				impacts[i].old_optimum_value != old_optimum_value ||
+				impacts[i].optimum_changed != (old_optimum_value < expected.front().first))
+		{
+			result.first_mismatch = i;
+		}
+	}
+	result.reference_ms = milliseconds_since(reference_start);
+	result.speedup = result.engine_ms > 0 ? result.reference_ms / result.engine_ms : 1;
+	result.matches = result.first_mismatch < 0;
+	if (!result.matches)
+	{
+		std::cerr << "Impact differs from reference in case with seed " << case_seed << " for player " << result.first_mismatch + 1 << "\n";
+	}
+	results.push_back(result);
+}
+
+void out(std::ostream& stream, const harness_options& options, const std::vector<harness_case_result>& results)
+{
+	stream << "{\n\"harness\": \"raid_start_times differential\",\n\"seed\": " << options.seed <<
+		",\n\"cases\": " << options.cases << ",\n\"results\": [\n";
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const auto& r = results[i];
+		stream << "  {\"case_seed\": " << r.case_seed << ", \"engine\": \"" << r.engine << "\", \"players\": " << r.players <<
+			", \"raid_times\": " << r.raid_times << ", \"top\": " << r.top <<
+			", \"matches\": " << (r.matches ? "true" : "false") << ", \"first_mismatch\": " << r.first_mismatch <<
+			", \"reference_ms\": " << r.reference_ms << ", \"engine_ms\": " << r.engine_ms <<
+			", \"speedup\": " << r.speedup << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	stream << "]\n}\n";
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		harness_options options;
+		options.parse(argc, argv);
+
+		std::vector<harness_case_result> results;
+		run_impact_case(0, tied_optimum_input, results);
+		for (unsigned int i = 0; i < options.cases; ++i)
+		{
+			run_case(options, options.seed + i, i % 4 == 3, results);
+			if (i % 4 == 1)
+			{
+				run_joint_case(options, options.seed + i, results);
+			}
+			if (i % 4 == 0)
+			{
+				run_week_case(options, options.seed + i, results);
+			}
+			if (i % 4 == 2)
+			{
+				const std::string text = case_generator(options, options.seed + i).generate_impact();
+				if (options.dump)
+				{
+					std::cout << text;
+				}
+				run_impact_case(options.seed + i, text, results);
+			}
+		}
+
+		unsigned int mismatches = 0;
+		for (const auto& result : results)
+		{
+			mismatches += result.matches ? 0 : 1;
+		}
+		std::cerr << options.cases << " cases, " << number_of_solver_engines << " engines, " << mismatches << " mismatches\n";
+
+		if (options.output.empty())
+		{
+			if (!options.dump)
+			{
+				out(std::cout, options, results);
+			}
+		}
+		else
+		{
+			std::ofstream file(options.output);
+			out(file, options, results);
+			if (!file)
+			{
+				throw std::runtime_error("Failed writing " + options.output);
+			}
+		}
+		return mismatches ? 1 : 0;
+	}
+	catch (parse_error& e)
+	{
+		std::cerr << "Generated input could not be parsed: " << e.what() << "\n";
+		return 1;
+	}
+	catch (std::runtime_error& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
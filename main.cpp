@@ -4,940 +4,2049 @@
 #include <vector>
 #include <locale>
 #include <map>
+#include <bitset>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+#include <iomanip>
+#include <queue>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "raid_solver_internal.hpp"
 //#include "string_view.hpp"
 
-#if USE_GLIB_FOR_UTF8
-#include <glib.h>
+#if USE_PERF_EVENTS
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
 #endif
 
 /*****************************************************************************/
-// Debug macros
+// Run statistics
+//
+// Collected always, as counters are cheap, but phase timers read the clock only
+// when statistics were requested. Phase timers nest, time of inner phase is
+// not accounted to outer one, so times of all phases sum up to whole run.
 
-#ifndef DEBUG
-#define DEBUG 0
-#endif
-
-#if DEBUG
-#define DEBUG_LOG \
-	std::cout
-#else
-#define DEBUG_LOG \
-	if (0) std::cout
-#endif
+typedef std::chrono::steady_clock search_clock;
 
-/*****************************************************************************/
-// UTF related stuff
-
-#if USE_GLIB_FOR_UTF8
+#if USE_PERF_EVENTS
 
-/* Glib has own UTF implementation which seems to behave much better than gnu
- * libc I am lazy so I don't use in place checking. Also any right to left
- * issues are completly ignored in this function.
+/* Hardware counters of this process, counted in user space only. If kernel
+ * does not allow perf_event_open (see /proc/sys/kernel/perf_event_paranoid),
+ * counters are reported as unavailable.
  */
-size_t console_width(const std::string& line)
+class hardware_counters
 {
-	glong items_read = 0;
-	glong items_written = 0;
-	GError* error = nullptr;
-	auto ucs4string = g_utf8_to_ucs4(line.c_str(), line.size(), &items_read, &items_written, &error);
-	if (ucs4string == nullptr)
+public:
+	enum counter_id { cycles, instructions, branch_misses, number_of_counters };
+
+	hardware_counters()
 	{
-		return std::string::npos;
+		const unsigned long long configs[number_of_counters] = {
+			PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES};
+		for (unsigned int i = 0; i < number_of_counters; ++i)
+		{
+			perf_event_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.size = sizeof(attr);
+			attr.config = configs[i];
+			attr.disabled = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			descriptors[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+		}
 	}
 
-	size_t width = 0;
-
-	for (size_t position = 0; position < items_written; ++position)
+	~hardware_counters()
 	{
-		if (g_unichar_iswide(ucs4string[position]))
+		for (const auto descriptor : descriptors)
 		{
-			width += 2;
-			continue;
+			if (descriptor != -1)
+			{
+				close(descriptor);
+			}
 		}
-		if (g_unichar_iszerowidth(ucs4string[position]))
+	}
+
+	void start()
+	{
+		for (const auto descriptor : descriptors)
 		{
-			continue;
+			if (descriptor != -1)
+			{
+				ioctl(descriptor, PERF_EVENT_IOC_RESET, 0);
+				ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+			}
 		}
-		width += 1;
 	}
-	g_free(ucs4string);
-	return width;
-}
-
-#elif TRUST_WCSWIDTH
 
-/* POSIX provides wcswidth, which should work correctly, but does not, and it
- * requires conversion from UTF-8 to wide characters.
- * Of coures we don't deal with right to left issues here too.
- */
-size_t console_width(const std::string& line)
-{
-	wchar_t*  buffer = new wchar_t[line.size()];
-	mbstowcs(buffer, line.c_str(), line.size());
-	int width = wcswidth(buffer, line.size());
-	delete[] buffer;
-	if (width != -1 )
+	void stop()
 	{
-		return width;
+		for (const auto descriptor : descriptors)
+		{
+			if (descriptor != -1)
+			{
+				ioctl(descriptor, PERF_EVENT_IOC_DISABLE, 0);
+			}
+		}
 	}
-	return std::string::npos;
-}
-
-#else // Lack of library support for UTF
-
-size_t console_width(const std::string& /*line*/)
-{
-	return std::string::npos;
-}
-
-#endif // USE_GLIB_FOR_UTF8 | TRUST_WCSWIDT | Lack of library support for UTF
 
-std::string spacer(const std::string& line, size_t position)
-{
-	if (position == std::string::npos)
+	bool available(counter_id counter) const
 	{
-		position = line.size();
+		return descriptors[counter] != -1;
 	}
-	std::string to_measure = line.substr(0, position);
-	size_t width = console_width(to_measure);
-	if (width == std::string::npos)
+
+	unsigned long long value(counter_id counter) const
 	{
-		return to_measure;
+		unsigned long long retval = 0;
+		if (read(descriptors[counter], &retval, sizeof(retval)) != sizeof(retval))
+		{
+			return 0;
+		}
+		return retval;
 	}
-	return std::string(width, ' ');
-}
 
-/*****************************************************************************/
-// Parsing helpers
+private:
+	int descriptors[number_of_counters];
+};
 
-#define MARK_ERROR(line, position) \
-	line << "\n" << spacer(line, position) << "^" << "\n"
+#endif // USE_PERF_EVENTS
 
-#define POS_PRINT(line, position) \
-	"position: " << position << "\n" << MARK_ERROR(line, position)
+struct run_statistics
+{
+	enum phase_id { other, parse, lookup_table, enumeration, scoring, sorting, printing, number_of_phases };
 
+	bool enabled = false;
+	phase_id current_phase = other;
+	search_clock::time_point run_start;
+	search_clock::time_point phase_start;
+	search_clock::duration phase_time[number_of_phases];
 
-// no string_literals in C++11
-//using namespace std::string_literals;
+	unsigned long long candidates_generated = 0;
+	unsigned long long candidates_scored = 0;
+	unsigned long long result_insertions = 0;
 
-std::locale loc{""};
+	unsigned long long result_bytes_allocated = 0;
+	unsigned long long result_bytes_in_use = 0;
+	unsigned long long result_bytes_peak = 0;
 
-size_t next_not_white_position(const std::string& line, size_t position)
-{
-	while (position < line.size() && std::isspace(line[position], loc))
-	{
-		++position;
-	}
-	if (position == line.size())
-	{
-		position = std::string::npos;
-	}
-	return position;
-}
+	// Engines of the library neither report generated candidates nor use
+	// counting allocator, those counters are then printed as null
+	bool candidates_generated_counted = true;
+	bool result_container_counted = true;
 
-size_t previous_not_white_position(const std::string& line, size_t position)
-{
-	while (position < line.size() && std::isspace(line[position], loc))
-	{
-		--position;
-	}
-	if (position == line.size())
-	{
-		position = std::string::npos;
-	}
-	return position;
-}
+#if USE_PERF_EVENTS
+	hardware_counters hardware;
+#endif
 
-bool is_comment(const std::string& line)
-{
-	if (line.empty())
+	void start()
 	{
-		return true;
-	}
-	if (line[0] == '#')
-	{
-		return true;
-	}
-	if (next_not_white_position(line, 0) == std::string::npos)
-	{
-		return true;
+		enabled = true;
+		for (auto& time : phase_time)
+		{
+			time = search_clock::duration::zero();
+		}
+		run_start = phase_start = search_clock::now();
+#if USE_PERF_EVENTS
+		hardware.start();
+#endif
 	}
-	return false;
-}
 
-class parse_error : public std::runtime_error
-{
-public:
-	parse_error(const size_t position, const std::string& what) :
-		runtime_error(what),
-		_position(position)
+	void switch_phase(phase_id phase)
 	{
+		const auto now = search_clock::now();
+		phase_time[current_phase] += now - phase_start;
+		phase_start = now;
+		current_phase = phase;
 	}
-	size_t get_position()
+
+	void result_allocated(unsigned long long bytes)
 	{
-		return _position;
+		result_bytes_allocated += bytes;
+		result_bytes_in_use += bytes;
+		result_bytes_peak = std::max(result_bytes_peak, result_bytes_in_use);
 	}
-private:
-	const size_t _position;
-};
 
-int parse_int(const std::string& line, size_t& position, const std::string& name)
-{
-	size_t first_uncoverted = 0;
-	int number=0;
-	try
+	void result_deallocated(unsigned long long bytes)
 	{
-		number = std::stoi(line.substr(position, line.size() - position), &first_uncoverted);
+		result_bytes_in_use -= bytes;
 	}
-	catch (std::exception& e)
+
+	void out(std::ostream& stream)
 	{
-		throw parse_error(position + first_uncoverted, "Failed parsing of " + name + ", got following error: " + e.what());
-	}
-	position += first_uncoverted;
-	return number;
-	//DEBUG_LOG << "After parsing number\n" << POS_PRINT(line, position);
-}
+		static const char* const phase_names[number_of_phases] = {
+			"other", "parse", "lookup_table", "enumeration", "scoring", "sorting", "printing"};
 
-    template <typename int_type_T, typename converter_T>
-void parse_list_of_integers(const std::string& line, size_t& position, std::vector<int_type_T>& integers, const std::string& name, const size_t end_position, converter_T converter)
-{
-		while (position < end_position)
+		switch_phase(current_phase);
+#if USE_PERF_EVENTS
+		hardware.stop();
+#endif
+		auto nanoseconds = [] (search_clock::duration duration)
 		{
-			const auto next_coma_or_closing_brace_position = line.find_first_of(",)", position);
-			int value = parse_int(line, position, name);
-			position = next_not_white_position(line, position);
-			if (position != next_coma_or_closing_brace_position)
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+		};
+
+		stream << "{\"total_ns\": " << nanoseconds(phase_start - run_start) << ", \"phases_ns\": {";
+		for (unsigned int phase = 0; phase < number_of_phases; ++phase)
+		{
+			stream << (phase ? ", " : "") << "\"" << phase_names[phase] << "\": " << nanoseconds(phase_time[phase]);
+		}
+		auto counted = [] (bool is_counted, unsigned long long value)
+		{
+			return is_counted ? std::to_string(value) : std::string("null");
+		};
+
+		stream << "}, \"counters\": {\"candidates_generated\": " << counted(candidates_generated_counted, candidates_generated) <<
+			", \"candidates_scored\": " << candidates_scored <<
+			", \"result_insertions\": " << result_insertions <<
+			"}, \"result_container\": {\"bytes_allocated\": " << counted(result_container_counted, result_bytes_allocated) <<
+			", \"peak_bytes\": " << counted(result_container_counted, result_bytes_peak) <<
+			"}, \"hardware_counters\": ";
+#if USE_PERF_EVENTS
+		static const char* const counter_names[hardware_counters::number_of_counters] = {
+			"cycles", "instructions", "branch_misses"};
+		stream << "{";
+		for (unsigned int i = 0; i < hardware_counters::number_of_counters; ++i)
+		{
+			const auto counter = static_cast<hardware_counters::counter_id>(i);
+			stream << (i ? ", " : "") << "\"" << counter_names[i] << "\": ";
+			if (hardware.available(counter))
 			{
-				throw parse_error(position, "Garbage found after " + name);
+				stream << hardware.value(counter);
 			}
-			int_type_T converted = converter(value);
-			integers.push_back(converted);
-			if (position < end_position)
+			else
 			{
-				++position;
+				stream << "null";
 			}
 		}
+		stream << "}";
+#else
+		stream << "null";
+#endif
+		stream << "}\n";
+	}
+};
+
+run_statistics stats;
+
+/* Accounts time spent in its scope to given phase, if statistics are enabled */
+class phase_timer
+{
+public:
+	explicit phase_timer(run_statistics::phase_id phase) :
+		previous_phase(stats.current_phase)
+	{
+		if (stats.enabled)
+		{
+			stats.switch_phase(phase);
+		}
+	}
 
-		if (position != end_position)
+	~phase_timer()
+	{
+		if (stats.enabled)
 		{
-			throw parse_error(position, "Garbage found after last " + name);
+			stats.switch_phase(previous_phase);
 		}
-};
+	}
 
-// Do nothing converter for parse_list_of_integers
-int void_converter(int value)
-{
-	return value;
+private:
+	const run_statistics::phase_id previous_phase;
 };
 
-unsigned int parse_guild_activities_reset_time(const std::string& line, size_t& position)
+/* Splits time of a loop over candidates between phases without reading the
+ * clock for every candidate: only every sample_interval-th candidate is timed
+ * and its times are extrapolated to all of them. When the sampler goes out of
+ * scope, estimated times are moved from the phase of the loop to the phases
+ * laps were accounted to, never more than the loop took.
+ */
+class phase_sampler
 {
-	const auto colon_position = line.find_first_of(":", position);
-	if (colon_position == std::string::npos)
+public:
+	phase_sampler() :
+		loop_phase(stats.current_phase),
+		loop_time_at_start(stats.phase_time[stats.current_phase])
 	{
-		throw parse_error(position, "There shall be colon in guild reset time");
+		for (auto& time : sampled_time)
+		{
+			time = search_clock::duration::zero();
+		}
 	}
 
-	int guild_activities_reset_reset_hour = parse_int(line, position, "guild activities reset time");
-	if (guild_activities_reset_reset_hour < 0 || guild_activities_reset_reset_hour > 23)
+	~phase_sampler()
 	{
-		throw parse_error(position, "Invalid guild reset hour, got " + std::to_string(guild_activities_reset_reset_hour) +
-				" which is not reasonable --- should be not negative and smaller than 24");
+		const unsigned long long samples = candidates / sample_interval;
+		if (!stats.enabled || samples == 0)
+		{
+			return;
+		}
+		// Accounts time of the loop so far
+		stats.switch_phase(loop_phase);
+		std::chrono::duration<double> sampled_total(0);
+		for (const auto& time : sampled_time)
+		{
+			sampled_total += time;
+		}
+		const std::chrono::duration<double> loop_time = stats.phase_time[loop_phase] - loop_time_at_start;
+		double scale = static_cast<double>(candidates) / samples;
+		if (sampled_total * scale > loop_time)
+		{
+			scale = loop_time / sampled_total;
+		}
+		for (unsigned int phase = 0; phase < run_statistics::number_of_phases; ++phase)
+		{
+			const auto moved = std::chrono::duration_cast<search_clock::duration>(
+					std::chrono::duration<double>(sampled_time[phase]) * scale);
+			stats.phase_time[phase] += moved;
+			stats.phase_time[loop_phase] -= moved;
+		}
 	}
 
-	position = next_not_white_position(line, position);
-	if (colon_position != position)
+	/* Called for each candidate, true when it is sampled and laps should be
+	 * taken after each of its phases
+	 */
+	bool start()
 	{
-		throw parse_error(position, "Garbage found between end of guild reset hour and colon");
+		if (!stats.enabled || ++candidates % sample_interval != 0)
+		{
+			return false;
+		}
+		lap_start = search_clock::now();
+		return true;
 	}
 
-	// skip colon
-	++position;
-
-	int minutes = parse_int(line, position, "minutes of guild activities reset time");
-	if (minutes != 30)
+	/* Time since start or previous lap was spent in phase */
+	void lap(run_statistics::phase_id phase)
 	{
-		throw parse_error(position, "Guild reset time must be exactly halfhour, but we found it at " + std::to_string(minutes) +
-				" after whole hour, is in non-standard time-zone in use?");
+		const auto now = search_clock::now();
+		sampled_time[phase] += now - lap_start;
+		lap_start = now;
 	}
 
-	return guild_activities_reset_reset_hour;
-}
+private:
+	static const unsigned int sample_interval = 64;
 
-/*****************************************************************************/
+	const run_statistics::phase_id loop_phase;
+	const search_clock::duration loop_time_at_start;
+	unsigned long long candidates = 0;
+	search_clock::time_point lap_start;
+	search_clock::duration sampled_time[run_statistics::number_of_phases];
+};
 
-class time_bitmap
+/* Allocator for result containers, which counts memory used by them */
+template <typename T>
+struct counting_allocator
 {
-public:
-	unsigned int get_data() const
+	typedef T value_type;
+
+	counting_allocator()
 	{
-		return data;
 	}
 
-	bool is_set(unsigned int hour) const
+	template <typename U>
+	counting_allocator(const counting_allocator<U>&)
 	{
-		return data & (1u << hour);
 	}
 
-	void set(unsigned int hour)
+	T* allocate(size_t n)
 	{
-		data |= 1u << hour;
+		stats.result_allocated(n * sizeof(T));
+		return static_cast<T*>(::operator new(n * sizeof(T)));
 	}
 
-	void unset(unsigned int hour)
+	void deallocate(T* pointer, size_t n)
 	{
-		data &= ~(1u << hour);
+		stats.result_deallocated(n * sizeof(T));
+		::operator delete(pointer);
 	}
+};
+
+template <typename T, typename U>
+bool operator==(const counting_allocator<T>&, const counting_allocator<U>&)
+{
+	return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const counting_allocator<T>&, const counting_allocator<U>&)
+{
+	return false;
+}
 
-	void out() const
+typedef std::multimap<long long, time_bitmap, std::greater<long long>,
+	counting_allocator<std::pair<const long long, time_bitmap> > > results_map;
+
+// Informative messages (roster echo, warnings), they go to stderr when results
+// are printed in machine readable format
+std::ostream* messages = &std::cout;
+
+/*****************************************************************************/
+// Output of results
+//
+// Results are formatted into one large buffer which is written to the stream in
+// big chunks, name of each player is rendered only once for all solutions.
+
+enum output_format { text_output, csv_output, json_output };
+
+class result_writer
+{
+public:
+	result_writer(std::ostream& s, output_format f, const roster& p, const single_player_value_lookup_table& v, bool joint = false) :
+		stream(s),
+		format(f),
+		players(p),
+		values(v)
 	{
-		for (unsigned int i = 0; i < 32; ++i)
+		buffer.reserve(buffer_size + 4096);
+		for (size_t i = 0; i < players.size(); ++i)
 		{
-			if (is_set(i))
+			const std::string name = players.name(i);
+			if (format == text_output)
+			{
+				player_prefixes.push_back(name + "(");
+			}
+			else if (format == csv_output)
+			{
+				player_prefixes.push_back("," + csv_field(name) + ",");
+			}
+			else
 			{
-				std::cout << i << " ";
+				player_prefixes.push_back("{\"name\": " + json_string(name) + ", \"best_times\": ");
 			}
 		}
-	}
 
-	time_bitmap operator&(const time_bitmap& other) const
-	{
-		time_bitmap retval;
-		retval.data = data & other.data;
-		return retval;
+		if (format == csv_output)
+		{
+			append(joint ? "rank,value,raid,raid_value,hours,player,best_times,acceptable_times,best_value,acceptable_value\n" :
+					"rank,value,hours,player,best_times,acceptable_times,best_value,acceptable_value\n");
+		}
+		else if (format == json_output)
+		{
+			append("{\"solutions\": [");
+		}
 	}
 
-	time_bitmap& operator^=(const time_bitmap& other)
+	~result_writer()
 	{
-		data ^= other.data;
-		return *this;
+		if (format == json_output)
+		{
+			append(solutions_written ? "\n]}\n" : "]}\n");
+		}
+		flush();
 	}
-private:
-	unsigned int data = 0;
-};
-
-struct config_header
-{
 
-	unsigned int number_of_raid_times;
-	unsigned int hour_of_master_activities_reset;
-	std::vector<int> best_weights;
-	std::vector<int> acceptable_weights;
-
-	void out()
+	void solution(long long value, const time_bitmap& sol)
 	{
-		std::cout << "best\n";
-		for (const auto& i : best_weights)
+		begin_solution(value);
+		for (unsigned int hour = 0; hour < 24; ++hour)
 		{
-			std::cout << i << "\n";
+			if (sol.is_set(hour))
+			{
+				solution_hour(hour);
+			}
 		}
-		std::cout << "acceptable\n";
-		for (const auto& i : acceptable_weights)
+		end_solution_hours(1);
+		for (size_t i = 0; i < players.size(); ++i)
 		{
-			std::cout << i << "\n";
+			player_row(i, player_score(number_of_set_bits((players.best_times(i) & sol).get_data()),
+						number_of_set_bits((players.acceptable_times(i) & sol).get_data()), values));
 		}
+		end_solution();
 	}
 
-};
-
-struct config_header_parser : config_header
-{
-	static const std::string raid_times_label;
-	static const std::string guild_reset_label;
-	static const std::string best_weights_label;
-	static const std::string acceptable_weights_label;
-
-	bool number_of_raid_times_parsed = false;
-	bool hour_of_master_activities_reset_parsed = false;
-	bool best_weights_parsed = false;
-	bool acceptable_weights_parsed = false;
-
-	bool parsed() const
-	{
-		return number_of_raid_times_parsed && hour_of_master_activities_reset_parsed && best_weights_parsed && acceptable_weights_parsed;
-	}
-
-	bool parse_label(const std::string& line, size_t& position, const std::string& label)
+	/* Solution of weekly calendar, equivalent is number of solutions which
+	 * differ only by slots for which all players have the same preferences.
+	 */
+	void week_solution(long long value, const week_bitmap& sol, double equivalent)
 	{
-		if (line.find(label, position) == position)
+		begin_solution(value);
+		for (unsigned int slot = 0; slot < hours_in_week; ++slot)
 		{
-			position = next_not_white_position(line, label.size());
-			if (position == std::string::npos)
+			if (sol.test(slot))
 			{
-				throw parse_error(raid_times_label.size(), "Expected something after label \"" + label + "\", but found only whitespace");
+				solution_hour(week_slot_label(slot));
 			}
-		        //DEBUG_LOG << "After post label whitespace skip\n" << POS_PRINT(line, position);
-			return true;
 		}
-		return false;
+		end_solution_hours(equivalent);
+		for (size_t i = 0; i < players.size(); ++i)
+		{
+			player_row(i, player_score((players.best_week(i) & sol).count(),
+						(players.acceptable_week(i) & sol).count(), values));
+		}
+		end_solution();
 	}
 
-	void check_for_end_of_line_garbage(const std::string& line, size_t& position)
+	/* Solution of several raids optimized together, raids are written with
+	 * raid_solution between begin_joint_solution and end_joint_solution.
+	 */
+	void begin_joint_solution(long long total)
 	{
-		position = next_not_white_position(line, position);
-		if (position != std::string::npos)
+		++solutions_written;
+		raids_written = 0;
+		if (format == text_output)
+		{
+			append(total);
+			append(":\n");
+		}
+		else if (format == csv_output)
+		{
+			csv_joint_prefix = std::to_string(solutions_written) + "," + std::to_string(total) + ",";
+		}
+		else
 		{
-			throw parse_error(position, "Garbage found at the end of line");
+			append(solutions_written > 1 ? ",\n{\"value\": " : "\n{\"value\": ");
+			append(total);
+			append(", \"raids\": [");
 		}
 	}
 
-	void parse(const std::string& line)
+	/* Hours are shifted from guild reset timezone of the first raid to the one
+	 * of this raid
+	 */
+	void raid_solution(long long value, const time_bitmap& sol, const single_player_value_lookup_table& raid_values, unsigned int hour_shift)
 	{
-		size_t position = next_not_white_position(line, 0);
-		//DEBUG_LOG << "After whitespace skip\n" << POS_PRINT(line, position);;
-
-		if (parse_label(line, position, raid_times_label))
+		++raids_written;
+		first_hour = true;
+		if (format == text_output)
+		{
+			append("Raid ");
+			append(raids_written);
+			append(' ');
+			append(value);
+			append(':');
+		}
+		else if (format == csv_output)
 		{
-			parse_number_of_best_raid_times(line, position);
-			number_of_raid_times_parsed = true;
+			csv_solution_prefix = csv_joint_prefix + std::to_string(raids_written) + "," + std::to_string(value) + ",";
 		}
-		else if (parse_label(line, position, guild_reset_label))
+		else
 		{
-			parse_hour_of_master_activities_reset(line, position);
-			hour_of_master_activities_reset_parsed = true;
+			append(raids_written > 1 ? ", {\"raid\": " : "{\"raid\": ");
+			append(raids_written);
+			append(", \"value\": ");
+			append(value);
+			append(", \"hours\": [");
 		}
-		else if (parse_label(line, position, best_weights_label))
+		for (unsigned int hour = 0; hour < 24; ++hour)
 		{
-			parse_list_of_integers(line, position, best_weights, "best weights", std::string::npos, void_converter);
-			best_weights_parsed = true;
+			if (sol.is_set((hour + 24 - hour_shift) % 24))
+			{
+				solution_hour(hour);
+			}
 		}
-		else if (parse_label(line, position, acceptable_weights_label))
+		end_solution_hours(1);
+		for (size_t i = 0; i < players.size(); ++i)
 		{
-			parse_list_of_integers(line, position, acceptable_weights, "acceptable weights", std::string::npos, void_converter);
-			acceptable_weights_parsed = true;
+			player_row(i, player_score(number_of_set_bits((players.best_times(i) & sol).get_data()),
+						number_of_set_bits((players.acceptable_times(i) & sol).get_data()), raid_values));
 		}
-		else
+		if (format == json_output)
 		{
-			throw parse_error(0, "Unrecognized header line, we expect one of:\n" +
-					raid_times_label + "\n" +
-					guild_reset_label + "\n" +
-					best_weights_label + "\n" +
-					acceptable_weights_label + "\n"
-					);
+			append("]}");
 		}
 	}
 
-	void parse_number_of_best_raid_times(const std::string& line, size_t& position)
+	void end_joint_solution()
 	{
-		const int number = parse_int(line, position, "number of raid times to seek");
-		if (number < 1 || number > 23)
+		if (format == text_output)
+		{
+			append('\n');
+		}
+		else if (format == json_output)
 		{
-			throw parse_error(position, "Invalid number of raid times to seek, got " + std::to_string(number) +
-					" which is not reasonable --- should be at least 1 and at most 23");
+			append("]}");
 		}
-		check_for_end_of_line_garbage(line, position);
-		number_of_raid_times = number;
+		flush_if_full();
 	}
 
-	void parse_hour_of_master_activities_reset(const std::string& line, size_t& position)
+	void flush()
 	{
-		hour_of_master_activities_reset = parse_guild_activities_reset_time(line, position);
-		check_for_end_of_line_garbage(line, position);
+		stream.write(buffer.data(), buffer.size());
+		buffer.clear();
 	}
-};
-
-const std::string config_header_parser::raid_times_label = "Number of best raid times to seek:";
-const std::string config_header_parser::guild_reset_label = "Guild activities reset time for results:";
-const std::string config_header_parser::best_weights_label = "Best times weights list:";
-const std::string config_header_parser::acceptable_weights_label = "Acceptable times weights list:";
-
-struct player
-{
-	std::string name;
-	bool guild_activities_reset_reset_hour_was_set = false;
-	unsigned int hour_of_guild_activities_reset_in_player_time;
-	time_bitmap best_times_in_master_time;
-	time_bitmap acceptable_times_in_master_time;
 
-	void out()
+	static std::string csv_field(const std::string& field)
 	{
-		std::cout << name << ", best(";
-		bool first_item_printed = false;
-		for (unsigned int i = 0; i < 24; ++i)
+		if (field.find_first_of(",\"\r\n") == std::string::npos)
 		{
-			if (best_times_in_master_time.is_set(i))
-			{
-				if (first_item_printed)
-				{
-					std::cout << ", ";
-				}
-				else
-				{
-					first_item_printed = true;
-				}
-				std::cout << i ;
-			}
+			return field;
 		}
-
-		std::cout << "), acceptable(" ;
-		first_item_printed = false;
-		for (unsigned int i = 0; i < 24; ++i)
+		std::string retval = "\"";
+		for (const auto c : field)
 		{
-			if (acceptable_times_in_master_time.is_set(i))
+			retval += c;
+			if (c == '"')
 			{
-				if (first_item_printed)
-				{
-					std::cout << ", ";
-				}
-				else
-				{
-					first_item_printed = true;
-				}
-				std::cout << i ;
+				retval += c;
 			}
 		}
-		std::cout << ")\n";
+		return retval + "\"";
 	}
-};
-
-struct player_parser : player
-{
-	const std::string& line;
-	const config_header& config;
 
-	player_parser(const std::string& l, config_header& header) : line(l), config(header)
+	static std::string json_string(const std::string& value)
 	{
-		const auto first_coma_position = line.find_first_of(",");
-		if (first_coma_position == std::string::npos)
+		std::string retval = "\"";
+		for (const auto c : value)
 		{
-			throw parse_error(0, "There shall be coma after player name ");
+			if (c == '"' || c == '\\')
+			{
+				retval += '\\';
+				retval += c;
+			}
+			else if (static_cast<unsigned char>(c) < 0x20)
+			{
+				const char* const hex = "0123456789abcdef";
+				retval += "\\u00";
+				retval += hex[(c >> 4) & 0xf];
+				retval += hex[c & 0xf];
+			}
+			else
+			{
+				retval += c;
+			}
 		}
+		return retval + "\"";
+	}
 
-		name = line.substr(0, first_coma_position);
-
-		DEBUG_LOG << "Getting data for player " << name << "\n";
-		DEBUG_LOG << line.substr(first_coma_position + 1) << "\n";
-
-		auto coma_position = first_coma_position;
-		for (unsigned int i = 0; i < 3 && coma_position != std::string::npos; ++i)
+private:
+	static const size_t buffer_size = 1 << 20;
+
+	std::ostream& stream;
+	const output_format format;
+	const roster& players;
+	const single_player_value_lookup_table& values;
+	std::vector<std::string> player_prefixes;
+	std::string buffer;
+	unsigned int solutions_written = 0;
+	// Rank, value and hours of current solution, repeated in every csv row
+	std::string csv_solution_prefix;
+	std::string csv_joint_prefix;
+	unsigned int raids_written = 0;
+	bool first_hour = true;
+
+	void begin_solution(long long value)
+	{
+		++solutions_written;
+		first_hour = true;
+		if (format == text_output)
 		{
-			coma_position = parse_single_command(coma_position);
+			append(value);
+			append(':');
 		}
-		if (coma_position != std::string::npos)
+		else if (format == csv_output)
 		{
-			throw parse_error(coma_position, "Unexpected coma");
+			csv_solution_prefix = std::to_string(solutions_written) + "," + std::to_string(value) + ",";
 		}
-
-		time_bitmap common_times = best_times_in_master_time & acceptable_times_in_master_time;
-		//common_times.data = best_times_in_master_time.data & acceptable_times_in_master_time.data;
-		if (common_times.get_data())
+		else
 		{
-			acceptable_times_in_master_time ^= common_times;
-			std::cout << name << " has duplicate entry(ies) between best and acceptable list, removed from the latter: " ;
-			for (unsigned int i = 0; i < 24; ++i)
-			{
-				if (common_times.is_set(i))
-				{
-					std::cout << i << " ";
-				}
-			}
-			std::cout << "\n";
+			append(solutions_written > 1 ? ",\n{\"value\": " : "\n{\"value\": ");
+			append(value);
+			append(", \"hours\": [");
 		}
 	}
 
-	size_t parse_single_command(const size_t pre_command_coma_position)
+	void solution_hour(unsigned int hour)
 	{
-		DEBUG_LOG << "Parsing single command \n";
-		const auto opening_brace_position = line.find_first_of("(", pre_command_coma_position + 1);
-
-		if (opening_brace_position == std::string::npos)
+		if (format == text_output)
 		{
-			// Opening brace not found, but lets emit a bit different message
-			throw parse_error(pre_command_coma_position, "There shall be \"reset(\" or \"best(\" or \"acceptable\" after coma");
+			append(hour);
+			append(' ');
 		}
-
-		const auto command_start = next_not_white_position(line, pre_command_coma_position + 1);
-		const auto command_end = previous_not_white_position(line, opening_brace_position - 1);
-
-		const auto closing_brace_position = line.find_first_of(")", opening_brace_position);
-		if (closing_brace_position == std::string::npos)
+		else if (format == csv_output)
 		{
-			throw parse_error(opening_brace_position, "There shall be closing brace after opening brace");
+			csv_solution_prefix += (first_hour ? "" : " ") + std::to_string(hour);
 		}
-
-
-		const std::string command = line.substr(command_start, command_end - command_start + 1);
-
-		DEBUG_LOG << "command: \"" << command << "\"\n";
-		DEBUG_LOG << "values: " << line.substr(opening_brace_position + 1, closing_brace_position - opening_brace_position - 1) << "\n";
-
-		const auto first_non_whitespace = next_not_white_position(line, closing_brace_position + 1);
-		const auto post_command_coma_position = line.find_first_of(",", first_non_whitespace);
-
-		DEBUG_LOG << "initial coma" << POS_PRINT(line, pre_command_coma_position) ;
-		DEBUG_LOG << "opening brace" << POS_PRINT(line, opening_brace_position) ;
-		DEBUG_LOG << "closing brace " << POS_PRINT(line, closing_brace_position) ;
-		DEBUG_LOG << "first not white" << POS_PRINT(line, first_non_whitespace) ;
-		DEBUG_LOG << "following coma" << POS_PRINT(line, post_command_coma_position) ;
-
-		// Note that if first_non_whitespace is npos, then post_command_coma_position will be npos too
-		if (first_non_whitespace != post_command_coma_position)
+		else
 		{
-			throw parse_error(first_non_whitespace, "Found garbage after closing brace in command (is ther missing coma?)");
+			append(first_hour ? "" : ", ");
+			append(hour);
 		}
+		first_hour = false;
+	}
 
-		size_t position = opening_brace_position + 1;
-
-		if (command == "reset")
-		{
-			hour_of_guild_activities_reset_in_player_time = parse_guild_activities_reset_time(line, position);
-			guild_activities_reset_reset_hour_was_set = true;
-
-			position = next_not_white_position(line, position);
-			if (position != closing_brace_position)
-			{
-				throw parse_error(position, "Garbage found after guild reset time");
-			}
-		}
-		else if (command == "best")
+	void solution_hour(const std::string& label)
+	{
+		if (format == text_output)
 		{
-			parse_list_of_times(position, best_times_in_master_time, "best time", closing_brace_position);
+			append(label);
+			append(' ');
 		}
-		else if (command == "acceptable")
+		else if (format == csv_output)
 		{
-			parse_list_of_times(position, acceptable_times_in_master_time, "acceptable time", closing_brace_position);
+			csv_solution_prefix += (first_hour ? "" : ";") + label;
 		}
 		else
 		{
-			throw parse_error(command_start, "Unrecognized command: " + command);
+			append(first_hour ? "\"" : ", \"");
+			append(label);
+			append('"');
 		}
-
-		return post_command_coma_position;
+		first_hour = false;
 	}
 
-	void parse_list_of_times(size_t& position, time_bitmap& times, const std::string& list_name, const size_t end_position)
+	void end_solution_hours(double equivalent)
 	{
-		DEBUG_LOG << "parsing list of " << list_name << "s for " << name << "\n";
-		if (!guild_activities_reset_reset_hour_was_set)
+		std::ostringstream equivalent_text;
+		if (equivalent > 1)
 		{
-			throw parse_error(position, "List of " + list_name + "s found before guild activities reset time");
+			equivalent_text << std::setprecision(15) << equivalent;
 		}
-
-		// If master time 18:30 is same as player time 19:30 then
-		// to convert from player to guild we need to distract 1
-		int diff = 24 + config.hour_of_master_activities_reset - hour_of_guild_activities_reset_in_player_time;
-
-		auto convert_int_to_time = [diff, &position, &list_name] (int local_time_hour) -> unsigned int
+		if (format == text_output)
 		{
-			if (local_time_hour < 0 || local_time_hour > 24)
+			if (equivalent > 1)
 			{
-				throw parse_error(position, "Invalid " + list_name + " hour, got " + std::to_string(local_time_hour) +
-						" which is not reasonable --- should be at least 0 and at most 24");
+				append("(" + equivalent_text.str() + " equivalent solutions)");
 			}
-			return (local_time_hour + diff) % 24;
-		};
-
-		std::vector<unsigned int> temporary_times;
-		parse_list_of_integers(line, position, temporary_times, list_name, end_position, convert_int_to_time);
-
-		for (const auto time : temporary_times)
+			append('\n');
+		}
+		else if (format == csv_output)
+		{
+			if (players.empty())
+			{
+				append(csv_solution_prefix);
+				append(",,,,,\n");
+			}
+		}
+		else
 		{
-			times.set(time);
+			append(']');
+			if (equivalent > 1)
+			{
+				append(", \"equivalent_solutions\": " + equivalent_text.str());
+			}
+			append(", \"players\": [");
 		}
 	}
 
-};
+	void player_row(size_t index, const player_score& score)
+	{
+		if (format == text_output)
+		{
+			append(player_prefixes[index]);
+			append(score.best_times);
+			append('|');
+			append(score.acceptable_times);
+			append(") (");
+			append(score.best_value);
+			append(" + ");
+			append(score.acceptable_value);
+			append(")\n");
+		}
+		else if (format == csv_output)
+		{
+			append(csv_solution_prefix);
+			append(player_prefixes[index]);
+			append(score.best_times);
+			append(',');
+			append(score.acceptable_times);
+			append(',');
+			append(score.best_value);
+			append(',');
+			append(score.acceptable_value);
+			append('\n');
+		}
+		else
+		{
+			append(index ? ", " : "");
+			append(player_prefixes[index]);
+			append(score.best_times);
+			append(", \"acceptable_times\": ");
+			append(score.acceptable_times);
+			append(", \"best_value\": ");
+			append(score.best_value);
+			append(", \"acceptable_value\": ");
+			append(score.acceptable_value);
+			append('}');
+		}
+		flush_if_full();
+	}
 
-struct all_solutions_iterator
-{
-	std::vector<unsigned int> included;
-	time_bitmap current;
+	void end_solution()
+	{
+		if (format == text_output)
+		{
+			append('\n');
+		}
+		else if (format == json_output)
+		{
+			append("]}");
+		}
+		flush_if_full();
+	}
 
-	static all_solutions_iterator begin(unsigned int times)
+	void flush_if_full()
 	{
-		return all_solutions_iterator(times);
+		if (buffer.size() >= buffer_size)
+		{
+			flush();
+		}
 	}
 
-	static all_solutions_iterator end(unsigned int times)
+	void append(char c)
 	{
-		auto retval = all_solutions_iterator();
-		retval.included.resize(times);
-		return retval;
+		buffer += c;
 	}
 
-	all_solutions_iterator()
+	void append(const char* s)
 	{
+		buffer += s;
 	}
 
-	all_solutions_iterator(unsigned int raid_times)
+	void append(const std::string& s)
 	{
-		for (unsigned int i = raid_times - 1; i < 24; --i)
+		buffer += s;
+	}
+
+	void append(long long number)
+	{
+		char digits[24];
+		char* end = digits + sizeof(digits);
+		char* begin = end;
+		unsigned long long magnitude = number < 0 ? 0ull - number : number;
+		do
+		{
+			*--begin = '0' + magnitude % 10;
+			magnitude /= 10;
+		}
+		while (magnitude);
+		if (number < 0)
 		{
-			included.push_back(i);
-			current.set(i);
+			*--begin = '-';
 		}
+		buffer.append(begin, end);
+	}
+
+	void append(unsigned int number)
+	{
+		append(static_cast<long long>(number));
 	}
+};
+
+
+template <typename results_T>
+void present_results(const results_T& results, result_writer& writer, size_t max_solutions = max_solutions_to_present)
+{
+	phase_timer timer(run_statistics::printing);
+	long long best_value = results.begin()->first;
+
+	unsigned int values_presented = 0;
+	unsigned int max_values_to_present = 2048;
+
+	unsigned int solutions_presented = 0;
+
+	for (const auto& sol : results)
+	{
+		if (sol.first < best_value)
+		{
+			++values_presented;
+		}
+		if (solutions_presented == max_solutions || values_presented == max_values_to_present)
+		{
+			break;
+		}
+		++solutions_presented;
+
+		writer.solution(sol.first, sol.second);
+	}
+	writer.flush();
+}
+
+void calculate_results(const config_header& header, const roster& players, output_format format, size_t max_solutions)
+{
+	DEBUG_LOG << " calculating results\n";
+	single_player_value_lookup_table values;
+	{
+		phase_timer timer(run_statistics::lookup_table);
+		values = build_value_lookup_table(header);
+	}
+
+	/*
+	24!
+	----
+	k!(24-k)!
 
-	all_solutions_iterator& operator++()
+	24| 1->     24
+	24| 2->    276
+	24| 3->   2024
+	24| 4->  10626
+	24| 5->  42504
+	24| 6-> 134596
+	24| 7-> 346104
+	24| 8-> 735471
+	24| 9->1307504
+	24|10->1961256
+	24|11->2496144
+	24|12->2704156 (each solution: 4 bytes for hours, 8 bytes for value -> less than 64MB)
+	*/
+	results_map results;
 	{
-		if (!current.get_data())
+		phase_timer timer(run_statistics::enumeration);
+		phase_sampler sampler;
+		auto it = all_solutions_iterator::begin(header.number_of_raid_times);
+		const auto end = all_solutions_iterator::end(header.number_of_raid_times);
+		for (; it != end; ++it)
 		{
-			return *this;
+			++stats.candidates_generated;
+			const bool sampled = sampler.start();
+			const auto& sol = *it;
+			const long long value = solution_value(sol, players, values);
+			if (sampled)
+			{
+				sampler.lap(run_statistics::scoring);
+			}
+			++stats.candidates_scored;
+			results.insert(std::make_pair(value, sol));
+			if (sampled)
+			{
+				sampler.lap(run_statistics::sorting);
+			}
+			++stats.result_insertions;
+			if (DEBUG)
+			{
+				sol.out(std::cout);
+				DEBUG_LOG << ": " << value << "\n";
+			}
 		}
+	}
+
+	result_writer writer(std::cout, format, players, values);
+	present_results(results, writer, max_solutions);
+}
+
+/* Same results as calculate_results, found by one of registered engines */
+void calculate_results_with_engine(const config_header& header, const roster& players, const solver_engine& engine, output_format format, size_t max_solutions)
+{
+	single_player_value_lookup_table values;
+	{
+		phase_timer timer(run_statistics::lookup_table);
+		values = build_value_lookup_table(header);
+	}
+
+	std::vector<scored_solution> results;
+	{
+		phase_timer timer(run_statistics::scoring);
+		stats.candidates_scored += engine.solve(header, players, max_solutions, results);
+	}
+	stats.result_insertions += results.size();
+	stats.candidates_generated_counted = false;
+	stats.result_container_counted = false;
+
+	result_writer writer(std::cout, format, players, values);
+	present_results(results, writer, max_solutions);
+}
 
-		/* This is how it works:
-		 * Times Bitmap i j
-		 * 0 1 2 11100  0 -
-		 * 0 1 3 11010  0 -
-		 * 0 1 4 11001  0 -
-		 * 0 1 5        1 -
-		 * 0 2 5        1 0
-		 * 0 2 3 10110  0 -
-		 * 0 2 4 10101  0 -
-		 * 0 2 5        1 -
-		 * 0 3 5        1 0
-		 * 0 3 4 10011  0 -
-		 * 0 3 5        1 -
-		 * 0 4 5        2 -
-		 * 1 4 5        2 1
-		 * 1 2 5        2 0
-		 * 1 2 3 01110  0 -
-		 * 1 2 4 01101  0 -
-		 * 1 2 5        1 -
-		 * 1 3 5        1 0
-		 * 1 3 4 01011  0 -
-		 * 1 3 5        1 -
-		 * 1 4 5        2 -
-		 * 2 4 5        2 1
-		 * 2 3 5        2 0
-		 * 2 3 4 00111  0 -
-		 * 2 3 5        1 -
-		 * 2 4 5        2 -
-		 * 3 4 5        - - (after i loop)
-		 * 3 4 5 00000
-		 */
-		for (unsigned int i = 0; i < included.size(); ++i)
+/*****************************************************************************/
+// Anytime search
+
+struct anytime_search_options
+{
+	// Zero means no deadline, search runs until whole space is covered
+	unsigned int deadline_ms = 0;
+	bool progress = false;
+	search_clock::time_point start = search_clock::now();
+};
+
+const std::chrono::milliseconds progress_interval(500);
+
+/* Hours ordered by value they bring to the guild when taken as the only raid
+ * time, most valuable first.
+ */
+std::vector<unsigned int> hours_by_marginal_value(const roster& players, const single_player_value_lookup_table& values)
+{
+	std::vector<long long> marginal_value(24, 0);
+	for (size_t i = 0; i < players.size(); ++i)
+	{
+		for (unsigned int hour = 0; hour < 24; ++hour)
 		{
-			current.unset(included[i]);
-			++included[i];
-			if (included[i] < (24 - i))
+			if (players.best_times(i).is_set(hour))
 			{
-				current.set(included[i]);
-				for (unsigned int j = (i - 1); j < 24; --j)
-				{
-					included[j] = included[j + 1] + 1;
-					current.set(included[j]);
-				}
-				return *this;
+				marginal_value[hour] += values.best[1];
+			}
+			else if (players.acceptable_times(i).is_set(hour))
+			{
+				marginal_value[hour] += values.acceptable[1];
 			}
 		}
-		current = time_bitmap();
-		return *this;
 	}
 
-	const time_bitmap& operator*() const
+	std::vector<unsigned int> hours;
+	for (unsigned int hour = 0; hour < 24; ++hour)
 	{
-		return current;
+		hours.push_back(hour);
 	}
+	std::stable_sort(hours.begin(), hours.end(), [&marginal_value] (unsigned int first, unsigned int second)
+	{
+		return marginal_value[first] > marginal_value[second];
+	});
+	return hours;
+}
 
-	bool operator==(const all_solutions_iterator& other) const
+/* Visits solutions in lexicographic order of positions in hours ranking, so
+ * solutions built from most valuable hours are checked first, and stops when
+ * deadline is reached. Every time when lowest ranking position changes, all
+ * solutions which are not yet visited can use only hours with worse rank, which
+ * gives upper bound used to prove that best solution found so far is optimal.
+ */
+void calculate_results_anytime(const config_header& header, const roster& players, const anytime_search_options& options, output_format format, size_t max_solutions)
+{
+	DEBUG_LOG << " calculating results with anytime search\n";
+	single_player_value_lookup_table values;
+	std::vector<unsigned int> hours;
+	{
+		phase_timer timer(run_statistics::lookup_table);
+		values = build_value_lookup_table(header);
+		hours = hours_by_marginal_value(players, values);
+	}
+
+	const unsigned long long candidates_total = number_of_combinations(24, header.number_of_raid_times);
+	unsigned long long candidates_visited = 0;
+
+	// Reading clock is not free, when there are many players single candidate
+	// takes long enough to check it more often.
+	const unsigned long long clock_check_interval = std::max<unsigned long long>(1, 65536 / (players.size() + 1));
+	const auto deadline = options.start + std::chrono::milliseconds(options.deadline_ms);
+	auto next_progress = search_clock::now() + progress_interval;
+
+	std::vector<scored_solution, counting_allocator<scored_solution> > results;
+	long long best_value = std::numeric_limits<long long>::min();
+
+	auto remaining_upper_bound = [&header, &players, &values, &hours] (unsigned int first_position)
 	{
-		if (this == &other)
+		time_bitmap available;
+		for (unsigned int position = first_position; position < 24; ++position)
 		{
-			return true;
+			available.set(hours[position]);
 		}
-		if (included.size() != other.included.size())
+		return solution_value_upper_bound(available, header.number_of_raid_times, players, values);
+	};
+	phase_timer enumeration_timer(run_statistics::enumeration);
+	phase_sampler sampler;
+	unsigned int first_position = 0;
+	long long upper_bound = remaining_upper_bound(first_position);
+
+	auto it = all_solutions_iterator::begin(header.number_of_raid_times);
+	const auto end = all_solutions_iterator::end(header.number_of_raid_times);
+	for (; it != end; ++it)
+	{
+		if (it.included.back() != first_position)
 		{
-			return false;
+			first_position = it.included.back();
+			upper_bound = remaining_upper_bound(first_position);
+		}
+
+		time_bitmap sol;
+		for (const auto position : it.included)
+		{
+			sol.set(hours[position]);
+		}
+		++stats.candidates_generated;
+		const bool sampled = sampler.start();
+		const long long value = solution_value(sol, players, values);
+		if (sampled)
+		{
+			sampler.lap(run_statistics::scoring);
+		}
+		++stats.candidates_scored;
+		results.push_back(scored_solution(value, sol));
+		if (sampled)
+		{
+			sampler.lap(run_statistics::sorting);
+		}
+		++stats.result_insertions;
+		best_value = std::max(best_value, value);
+		++candidates_visited;
+
+		if (candidates_visited % clock_check_interval == 0)
+		{
+			const auto now = search_clock::now();
+			if (options.deadline_ms != 0 && now >= deadline)
+			{
+				break;
+			}
+			if (options.progress && now >= next_progress)
+			{
+				next_progress = now + progress_interval;
+				std::cerr << "progress: visited " << candidates_visited << " of " << candidates_total <<
+					" candidates, best value so far: " << best_value << ", elapsed: " <<
+					std::chrono::duration_cast<std::chrono::milliseconds>(now - options.start).count() << " ms\n";
+			}
 		}
-		return current.get_data() == other.current.get_data();
 	}
 
-	bool operator!=(const all_solutions_iterator& other) const
+	const bool completed = candidates_visited == candidates_total;
+	const bool optimality_proven = completed || best_value >= upper_bound;
+	const auto search_ms = std::chrono::duration_cast<std::chrono::milliseconds>(search_clock::now() - options.start).count();
+
+	// Deadline bounds only the search, sorting and printing of presented
+	// solutions come after it, so the summary tells how long the search took
+	std::ostringstream coverage;
+	coverage << std::fixed << std::setprecision(2) << 100.0 * candidates_visited / candidates_total;
+	*messages << (completed ? "Search completed" : "Search stopped at deadline") << " after " << search_ms << " ms, visited " <<
+		candidates_visited << " of " << candidates_total << " candidates (" << coverage.str() << "% of solution space), optimality " <<
+		(optimality_proven ? "proven" : "not proven") << (options.deadline_ms ? ", presenting results is not included in the deadline" : "") << "\n";
+
 	{
-		return ! (*this == other);
+		phase_timer timer(run_statistics::sorting);
+		const auto presented = std::min<size_t>(results.size(), max_solutions);
+		std::partial_sort(results.begin(), results.begin() + presented, results.end(), is_presented_before);
 	}
+	result_writer writer(std::cout, format, players, values);
+	present_results(results, writer, max_solutions);
+}
 
-};
+/*****************************************************************************/
+// Weekly calendar
 
-/* Taken from:
- * https://stackoverflow.com/questions/109023/how-to-count-the-number-of-set-bits-in-a-32-bit-integer
- */
-unsigned int number_of_set_bits(unsigned int i)
+void calculate_week_results(const config_header& header, const roster& players, output_format format)
 {
-#if USE_POP_COUNT
-	return __builtin_popcount(i);
-#else
-	i = i - ((i >> 1) & 0x55555555u);
-	i = (i & 0x33333333u) + ((i >> 2) & 0x33333333u);
-	return (((i + (i >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24;
-#endif
+	DEBUG_LOG << " calculating weekly results\n";
+	single_player_value_lookup_table values;
+	{
+		phase_timer timer(run_statistics::lookup_table);
+		values = build_value_lookup_table(header);
+	}
+
+	std::vector<week_solution> results;
+	{
+		phase_timer timer(run_statistics::enumeration);
+		week_solver solver(header, players);
+		solver.solve(max_solutions_to_present, results);
+		stats.candidates_generated += solver.nodes_generated();
+		stats.candidates_scored += solver.nodes_bounded();
+		stats.result_insertions += results.size();
+		*messages << "Weekly calendar: " << hours_in_week << " slots grouped into " << solver.number_of_classes() <<
+			" classes of slots with identical preferences of all players\n";
+	}
+	stats.result_container_counted = false;
+
+	phase_timer timer(run_statistics::printing);
+	result_writer writer(std::cout, format, players, values);
+	for (const auto& sol : results)
+	{
+		writer.week_solution(sol.value, sol.slots, sol.equivalent);
+	}
+	writer.flush();
 }
 
-struct single_player_value_lookup_table
+/*****************************************************************************/
+// Joint optimization of several raids
+
+void calculate_joint_results(const std::vector<config_header>& headers, const roster& players, bool shared_hours, output_format format,
+		size_t max_solutions)
 {
-	std::vector<unsigned int> best;
-	std::vector<unsigned int> acceptable;
-};
+	DEBUG_LOG << " calculating joint results of " << headers.size() << " raids\n";
+	std::vector<single_player_value_lookup_table> values(headers.size());
+	// Difference between guild reset hour of each raid and of the first one,
+	// players' times are stored in timezone of the first raid
+	std::vector<unsigned int> hour_shifts(headers.size());
+	unsigned int all_raid_times = 0;
+	{
+		phase_timer timer(run_statistics::lookup_table);
+		for (size_t i = 0; i < headers.size(); ++i)
+		{
+			values[i] = build_value_lookup_table(headers[i]);
+			hour_shifts[i] = (24 + headers[i].hour_of_master_activities_reset - headers.front().hour_of_master_activities_reset) % 24;
+			all_raid_times += headers[i].number_of_raid_times;
+		}
+	}
+	if (!shared_hours && all_raid_times > 24)
+	{
+		throw std::runtime_error("Raids together seek " + std::to_string(all_raid_times) +
+				" raid times, which is more than 24 hours and they can't share hours");
+	}
 
-long long solution_value(const time_bitmap& solution, const std::vector<player>& players, const single_player_value_lookup_table& values)
+	std::vector<joint_solution> results;
+	{
+		phase_timer timer(run_statistics::enumeration);
+		stats.candidates_scored += solve_joint(headers, players, shared_hours, max_solutions, results);
+		stats.result_insertions += results.size();
+	}
+	stats.candidates_generated_counted = false;
+	stats.result_container_counted = false;
+
+	phase_timer timer(run_statistics::printing);
+	result_writer writer(std::cout, format, players, values.front(), true);
+	for (const auto& sol : results)
+	{
+		writer.begin_joint_solution(sol.value);
+		for (size_t i = 0; i < headers.size(); ++i)
+		{
+			writer.raid_solution(sol.raids[i].first, sol.raids[i].second, values[i], hour_shifts[i]);
+		}
+		writer.end_joint_solution();
+	}
+	writer.flush();
+}
+
+/*****************************************************************************/
+// Leave-one-out impact
+//
+// For every player best solution when the player is removed, compared with the
+// optimum of all players: how much value of the optimum drops and whether other
+// hours would be chosen.
+
+std::string impact_hours(const time_bitmap& sol, const char* separator)
 {
-	long long value = 0;
-	for (const auto& p : players)
+	std::string retval;
+	for (unsigned int hour = 0; hour < 24; ++hour)
 	{
-		const unsigned int best_times = number_of_set_bits((p.best_times_in_master_time & solution).get_data());
-		const unsigned int acceptable_times = number_of_set_bits((p.acceptable_times_in_master_time & solution).get_data());
-		value += values.best[best_times];
-		value += values.acceptable[best_times + acceptable_times] - values.acceptable[best_times];
-		DEBUG_LOG << p.name << " best(" << best_times << "), acceptable(" << acceptable_times << "), value(";
-		DEBUG_LOG << values.best[best_times] << " + " << values.acceptable[best_times + acceptable_times] - values.acceptable[best_times] << ")\n";
+		if (sol.is_set(hour))
+		{
+			retval += (retval.empty() ? "" : separator) + std::to_string(hour);
+		}
 	}
-	return value;
+	return retval;
 }
 
-long long solution_present(const time_bitmap& solution, const std::vector<player>& players, const single_player_value_lookup_table& values)
+void calculate_impact(const config_header& header, const roster& players, output_format format)
 {
-	long long value = 0;
-	for (const auto& p : players)
+	DEBUG_LOG << " calculating leave-one-out impact\n";
+	std::vector<player_impact> impacts;
+	scored_solution optimum;
+	{
+		phase_timer timer(run_statistics::scoring);
+		optimum = leave_one_out_impact(header, players, impacts);
+	}
+	// Every solution is enumerated and scored, none is kept in result container
+	stats.candidates_generated += number_of_combinations(24, header.number_of_raid_times);
+	stats.candidates_scored += number_of_combinations(24, header.number_of_raid_times);
+	stats.result_container_counted = false;
+
+	phase_timer timer(run_statistics::printing);
+	std::ostringstream out;
+	if (format == text_output)
+	{
+		out << "Optimum of all players " << optimum.first << ": " << impact_hours(optimum.second, " ") << "\n";
+	}
+	else if (format == csv_output)
+	{
+		*messages << "Optimum of all players " << optimum.first << ": " << impact_hours(optimum.second, " ") << "\n";
+		out << "player,value,hours,value_drop,optimum_changed,old_optimum_value\n";
+	}
+	else
+	{
+		out << "{\"optimum\": {\"value\": " << optimum.first << ", \"hours\": [" << impact_hours(optimum.second, ", ") <<
+			"]}, \"players\": [";
+	}
+	for (size_t i = 0; i < players.size(); ++i)
+	{
+		const scored_solution& sol = impacts[i].optimum_without;
+		const bool changed = impacts[i].optimum_changed;
+		const long long drop = optimum.first - sol.first;
+		if (format == text_output)
+		{
+			out << "Without " << players.name(i) << " " << sol.first << ": " << impact_hours(sol.second, " ") <<
+				" (value drops by " << drop;
+			if (changed)
+			{
+				out << ", optimum changes, old one would have " << impacts[i].old_optimum_value;
+			}
+			out << ")\n";
+		}
+		else if (format == csv_output)
+		{
+			out << result_writer::csv_field(players.name(i)) << "," << sol.first << "," << impact_hours(sol.second, " ") << "," <<
+				drop << "," << (changed ? "true" : "false") << "," << impacts[i].old_optimum_value << "\n";
+		}
+		else
+		{
+			out << (i ? ",\n" : "\n") << "{\"name\": " << result_writer::json_string(players.name(i)) << ", \"value\": " << sol.first <<
+				", \"hours\": [" << impact_hours(sol.second, ", ") << "], \"value_drop\": " << drop <<
+				", \"optimum_changed\": " << (changed ? "true" : "false") <<
+				", \"old_optimum_value\": " << impacts[i].old_optimum_value << "}";
+		}
+	}
+	if (format == json_output)
 	{
-		const unsigned int best_times = number_of_set_bits((p.best_times_in_master_time & solution).get_data());
-		const unsigned int acceptable_times = number_of_set_bits((p.acceptable_times_in_master_time & solution).get_data());
-		std::cout << p.name << "(" << best_times << "|" << acceptable_times << ") (";
-		std::cout << values.best[best_times] << " + " << values.acceptable[best_times + acceptable_times] - values.acceptable[best_times] << ")\n";
+		out << (players.empty() ? "]}\n" : "\n]}\n");
 	}
-	return value;
+	std::cout << out.str();
 }
 
-void calculate_results(const config_header& header, const std::vector<player>& players)
+/*****************************************************************************/
+// Command line options
+
+struct program_options : anytime_search_options
 {
-	DEBUG_LOG << " calculating results\n";
-	single_player_value_lookup_table values;
+	static const std::string usage;
+
+	bool statistics = false;
+	output_format format = text_output;
+	std::string export_file;
+	bool shared_hours = true;
+	// Reference calculation when not set
+	const solver_engine* engine = nullptr;
+	bool engine_chosen = false;
+	unsigned int top = 0;
+	bool impact = false;
+
+	void parse(int argc, char* argv[])
 	{
-		unsigned int best_sum = 0;
-		unsigned int acceptable_sum = 0;
-		values.best.push_back(best_sum);
-		values.acceptable.push_back(acceptable_sum);
-		for (unsigned int i = 0; i < header.number_of_raid_times; ++i)
+		for (int i = 1; i < argc; ++i)
 		{
-			if (i < header.best_weights.size())
+			const std::string option = argv[i];
+			if (option == "--deadline" && i + 1 < argc)
 			{
-				best_sum += header.best_weights[i];
+				deadline_ms = parse_unsigned(option, argv[++i]);
+				if (deadline_ms == 0)
+				{
+					throw std::runtime_error("Deadline must be positive number of milliseconds\n" + usage);
+				}
+			}
+			else if (option == "--progress")
+			{
+				progress = true;
+			}
+			else if (option == "--stats")
+			{
+				statistics = true;
+			}
+			else if (option == "--format" && i + 1 < argc)
+			{
+				format = parse_format(option, argv[++i]);
 			}
-			else if (header.best_weights.empty() == false)
+			else if (option == "--export" && i + 1 < argc)
 			{
-				best_sum += header.best_weights.back();
+				export_file = argv[++i];
 			}
-			if (i < header.acceptable_weights.size())
+			else if (option == "--no-shared-hours")
 			{
-				acceptable_sum += header.acceptable_weights[i];
+				shared_hours = false;
 			}
-			else if (header.best_weights.empty() == false)
+			else if (option == "--engine" && i + 1 < argc)
 			{
-				acceptable_sum += header.acceptable_weights.back();
+				const std::string name = argv[++i];
+				engine = find_solver_engine(name);
+				if (engine == nullptr && name != "reference")
+				{
+					throw std::runtime_error("Unknown engine: " + name + "\n" + usage);
+				}
+				engine_chosen = true;
+			}
+			else if (option == "--impact")
+			{
+				impact = true;
+			}
+			else if (option == "--top" && i + 1 < argc)
+			{
+				top = parse_unsigned(option, argv[++i]);
+				if (top == 0)
+				{
+					throw std::runtime_error("Number of solutions to present must be positive\n" + usage);
+				}
 			}
-			values.best.push_back(best_sum);
-			values.acceptable.push_back(acceptable_sum);
+			else
+			{
+				throw std::runtime_error("Unrecognized option: " + option + "\n" + usage);
+			}
+		}
+		if (!export_file.empty() && anytime_search())
+		{
+			throw std::runtime_error("Export writes all solutions, it can't be combined with --deadline or --progress\n" + usage);
+		}
+		// Best few solutions are found much faster by lazy search, anytime
+		// search keeps its own order of hours
+		if (top != 0 && !engine_chosen && !anytime_search())
+		{
+			engine = find_solver_engine("best_first");
 		}
 	}
 
-	/*
-	24!
-	----
-	k!(24-k)!
+	size_t solutions_to_present() const
+	{
+		return top != 0 ? top : max_solutions_to_present;
+	}
 
-	24| 1->     24
-	24| 2->    276
-	24| 3->   2024
-	24| 4->  10626
-	24| 5->  42504
-	24| 6-> 134596
-	24| 7-> 346104
-	24| 8-> 735471
-	24| 9->1307504
-	24|10->1961256
-	24|11->2496144
-	24|12->2704156 (each solution: 4 bytes for hours, 8 bytes for value -> less than 64MB)
-	*/
-	std::multimap<long long, time_bitmap, std::greater<long long> > results;
-	auto it = all_solutions_iterator::begin(header.number_of_raid_times);
-	const auto end = all_solutions_iterator::end(header.number_of_raid_times);
-	for (; it != end; ++it)
+	bool anytime_search() const
+	{
+		return deadline_ms != 0 || progress;
+	}
+
+	static output_format parse_format(const std::string& option, const std::string& value)
 	{
-		const auto& sol = *it;
-		auto value = solution_value(sol, players, values);
-		results.insert(std::make_pair(value, sol));
-		if (DEBUG)
+		if (value == "text")
 		{
-			sol.out();
-			DEBUG_LOG << ": " << value << "\n";
+			return text_output;
 		}
+		if (value == "csv")
+		{
+			return csv_output;
+		}
+		if (value == "json")
+		{
+			return json_output;
+		}
+		throw std::runtime_error("Invalid value of " + option + ": " + value + "\n" + usage);
 	}
 
-	long long best_value = results.begin()->first;
+	static unsigned int parse_unsigned(const std::string& option, const std::string& value)
+	{
+		try
+		{
+			return ::parse_unsigned(option, value);
+		}
+		catch (std::runtime_error& e)
+		{
+			throw std::runtime_error(e.what() + ("\n" + usage));
+		}
+	}
+};
 
-	unsigned int values_presented = 0;
-	unsigned int max_values_to_present = 2048;
+const std::string program_options::usage =
+	"Usage: raid_start_times [--deadline MS] [--progress] [--stats] [--format text|csv|json]\n"
+	"                        [--export FILE] [--no-shared-hours] [--engine NAME] [--top N]\n"
+	"                        [--impact] < input.txt\n"
+	"       raid_start_times query FILE [--include HOURS] [--exclude HOURS] [--min-score S]\n"
+	"                        [--top N] [--format text|csv|json]\n"
+	"  --deadline MS  stop search after MS milliseconds and present best solutions found so far,\n"
+	"                 most promising hours are searched first, presenting them is not included,\n"
+	"                 combine with --top to keep it short\n"
+	"  --progress     print periodic progress lines on stderr\n"
+	"  --stats        print time spent in each phase and counters as JSON on stderr\n"
+	"  --format F     print results as text (default), csv or json, in the latter two cases\n"
+	"                 other messages go to stderr\n"
+	"  --export FILE  write all solutions sorted by score to binary FILE instead of presenting them\n"
+	"  --no-shared-hours\n"
+	"                 when input has several raid headers, raids can't start at the same hour\n"
+	"  --engine NAME  how results are calculated: reference (default), enumeration, nested or\n"
+	"                 best_first, all of them give the same results\n"
+	"  --top N        present only best N solutions, unless other engine or deadline is chosen\n"
+	"                 they are found by best_first engine, which searches only as much as needed,\n"
+	"                 with several raids N best combinations are presented\n"
+	"  --impact       for every player present best solution when the player is removed and\n"
+	"                 how much value of the optimum drops\n"
+	"  query          present best solutions from exported FILE, which include all of HOURS from\n"
+	"                 --include, none of HOURS from --exclude and have at least score S\n"
+	"                 HOURS are coma separated hours in timezone of exported results\n";
+
+struct query_options
+{
+	std::string file;
+	time_bitmap included;
+	time_bitmap excluded;
+	long long min_score = std::numeric_limits<long long>::min();
+	unsigned int top = 10;
+	output_format format = text_output;
+
+	void parse(int argc, char* argv[])
+	{
+		if (argc < 3)
+		{
+			throw std::runtime_error("Missing file to query\n" + program_options::usage);
+		}
+		file = argv[2];
+		for (int i = 3; i < argc; ++i)
+		{
+			const std::string option = argv[i];
+			if (option == "--include" && i + 1 < argc)
+			{
+				included = parse_hours(option, argv[++i]);
+			}
+			else if (option == "--exclude" && i + 1 < argc)
+			{
+				excluded = parse_hours(option, argv[++i]);
+			}
+			else if (option == "--min-score" && i + 1 < argc)
+			{
+				const std::string value = argv[++i];
+				size_t first_unconverted = 0;
+				try
+				{
+					min_score = std::stoll(value, &first_unconverted);
+				}
+				catch (std::exception&)
+				{
+					first_unconverted = 0;
+				}
+				if (first_unconverted == 0 || first_unconverted != value.size())
+				{
+					throw std::runtime_error("Invalid value of " + option + ": " + value + "\n" + program_options::usage);
+				}
+			}
+			else if (option == "--top" && i + 1 < argc)
+			{
+				top = program_options::parse_unsigned(option, argv[++i]);
+				if (top == 0)
+				{
+					throw std::runtime_error("Number of solutions to present must be positive\n" + program_options::usage);
+				}
+			}
+			else if (option == "--format" && i + 1 < argc)
+			{
+				format = program_options::parse_format(option, argv[++i]);
+			}
+			else
+			{
+				throw std::runtime_error("Unrecognized option: " + option + "\n" + program_options::usage);
+			}
+		}
+	}
 
-	unsigned int solutions_presented = 0;
-	unsigned int max_solutions_to_present = 2048;
+	static time_bitmap parse_hours(const std::string& option, const std::string& value)
+	{
+		time_bitmap hours;
+		std::istringstream list(value);
+		std::string hour;
+		while (std::getline(list, hour, ','))
+		{
+			const unsigned int parsed = program_options::parse_unsigned(option, hour);
+			if (parsed > 23)
+			{
+				throw std::runtime_error("Invalid hour in " + option + ": " + hour + "\n" + program_options::usage);
+			}
+			hours.set(parsed);
+		}
+		return hours;
+	}
+};
 
-	for (const auto& sol : results)
+/*****************************************************************************/
+// Export of all solutions
+//
+// File starts with export_file_header followed by fixed size records, 8 bytes
+// of score and 4 bytes of hours bitmap, sorted in order of presentation (best
+// score first). Numbers are stored in native byte order, so files can't be
+// shared between machines of different endianness.
+
+struct export_file_header
+{
+	char magic[4];
+	unsigned int version;
+	unsigned int number_of_raid_times;
+	unsigned int hour_of_master_activities_reset;
+	unsigned long long number_of_records;
+	unsigned long long reserved;
+};
+
+const char export_file_magic[4] = {'R', 'S', 'T', 'X'};
+const unsigned int export_file_version = 1;
+const size_t export_record_size = sizeof(long long) + sizeof(unsigned int);
+
+// Solutions sorted in memory at once, bounds memory used by export to about
+// 16 bytes per record
+const size_t export_run_records = 1 << 20;
+
+void write_record(char* destination, const scored_solution& solution)
+{
+	const unsigned int hours = solution.second.get_data();
+	memcpy(destination, &solution.first, sizeof(solution.first));
+	memcpy(destination + sizeof(solution.first), &hours, sizeof(hours));
+}
+
+scored_solution read_record(const char* source)
+{
+	long long value = 0;
+	unsigned int hours = 0;
+	memcpy(&value, source, sizeof(value));
+	memcpy(&hours, source + sizeof(value), sizeof(hours));
+	return scored_solution(value, time_bitmap(hours));
+}
+
+/* Buffered writer of records to stdio file */
+class record_writer
+{
+public:
+	explicit record_writer(FILE* f) :
+		file(f),
+		buffer(export_record_size * buffered_records)
 	{
-		if (sol.first < best_value)
+	}
+
+	void write(const scored_solution& solution)
+	{
+		write_record(&buffer[used], solution);
+		used += export_record_size;
+		if (used == buffer.size())
 		{
-			++values_presented;
+			flush();
 		}
-		if (solutions_presented == max_solutions_to_present || values_presented == max_values_to_present)
+	}
+
+	void flush()
+	{
+		if (used && fwrite(buffer.data(), 1, used, file) != used)
 		{
-			break;
+			throw std::runtime_error("Failed writing exported solutions");
+		}
+		used = 0;
+	}
+
+private:
+	static const size_t buffered_records = 4096;
+	FILE* file;
+	std::vector<char> buffer;
+	size_t used = 0;
+};
+
+/* Buffered reader of records from sorted run in temporary file */
+class record_reader
+{
+public:
+	explicit record_reader(FILE* f) :
+		file(f),
+		buffer(export_record_size * buffered_records)
+	{
+		rewind(file);
+		fill();
+	}
+
+	bool empty() const
+	{
+		return position == available;
+	}
+
+	scored_solution front() const
+	{
+		return read_record(&buffer[position]);
+	}
+
+	void pop()
+	{
+		position += export_record_size;
+		if (position == available)
+		{
+			fill();
+		}
+	}
+
+private:
+	static const size_t buffered_records = 4096;
+	FILE* file;
+	std::vector<char> buffer;
+	size_t position = 0;
+	size_t available = 0;
+
+	void fill()
+	{
+		position = 0;
+		available = fread(buffer.data(), 1, buffer.size(), file);
+		available -= available % export_record_size;
+	}
+};
+
+/* External sort: solutions are scored in enumeration order, every
+ * export_run_records of them are sorted and stored in temporary file and at
+ * the end all runs are merged into exported file.
+ */
+void export_results(const config_header& header, const roster& players, const std::string& file_name)
+{
+	DEBUG_LOG << " exporting results\n";
+	single_player_value_lookup_table values;
+	{
+		phase_timer timer(run_statistics::lookup_table);
+		values = build_value_lookup_table(header);
+	}
+
+	std::vector<scored_solution, counting_allocator<scored_solution> > run;
+	run.reserve(export_run_records);
+	std::vector<FILE*> runs;
+	auto close_runs = [&runs] ()
+	{
+		for (auto file : runs)
+		{
+			fclose(file);
+		}
+	};
+
+	try
+	{
+		auto store_run = [&run, &runs] ()
+		{
+			phase_timer timer(run_statistics::sorting);
+			std::sort(run.begin(), run.end(), is_presented_before);
+			FILE* file = tmpfile();
+			if (file == nullptr)
+			{
+				throw std::runtime_error("Failed creating temporary file for export");
+			}
+			runs.push_back(file);
+			record_writer writer(file);
+			for (const auto& sol : run)
+			{
+				writer.write(sol);
+			}
+			writer.flush();
+			run.clear();
+		};
+
+		unsigned long long number_of_records = 0;
+		{
+			phase_timer timer(run_statistics::enumeration);
+			phase_sampler sampler;
+			auto it = all_solutions_iterator::begin(header.number_of_raid_times);
+			const auto end = all_solutions_iterator::end(header.number_of_raid_times);
+			for (; it != end; ++it)
+			{
+				++stats.candidates_generated;
+				const bool sampled = sampler.start();
+				const long long value = solution_value(*it, players, values);
+				if (sampled)
+				{
+					sampler.lap(run_statistics::scoring);
+				}
+				++stats.candidates_scored;
+				run.push_back(scored_solution(value, *it));
+				++stats.result_insertions;
+				++number_of_records;
+				if (run.size() == export_run_records)
+				{
+					store_run();
+				}
+			}
+		}
+		if (!run.empty())
+		{
+			store_run();
+		}
+
+		phase_timer timer(run_statistics::printing);
+		FILE* file = fopen(file_name.c_str(), "wb");
+		if (file == nullptr)
+		{
+			throw std::runtime_error("Failed opening " + file_name + " for writing");
+		}
+		runs.push_back(file);
+
+		export_file_header file_header;
+		memset(&file_header, 0, sizeof(file_header));
+		memcpy(file_header.magic, export_file_magic, sizeof(file_header.magic));
+		file_header.version = export_file_version;
+		file_header.number_of_raid_times = header.number_of_raid_times;
+		file_header.hour_of_master_activities_reset = header.hour_of_master_activities_reset;
+		file_header.number_of_records = number_of_records;
+		if (fwrite(&file_header, sizeof(file_header), 1, file) != 1)
+		{
+			throw std::runtime_error("Failed writing " + file_name);
+		}
+
+		std::vector<record_reader> readers;
+		for (size_t i = 0; i + 1 < runs.size(); ++i)
+		{
+			readers.push_back(record_reader(runs[i]));
+		}
+		typedef std::pair<scored_solution, size_t> merged_record;
+		auto merge_order = [] (const merged_record& first, const merged_record& second)
+		{
+			return is_presented_before(second.first, first.first);
+		};
+		std::priority_queue<merged_record, std::vector<merged_record>, decltype(merge_order)> merge(merge_order);
+		for (size_t i = 0; i < readers.size(); ++i)
+		{
+			if (!readers[i].empty())
+			{
+				merge.push(merged_record(readers[i].front(), i));
+				readers[i].pop();
+			}
+		}
+
+		record_writer writer(file);
+		while (!merge.empty())
+		{
+			const auto next = merge.top();
+			merge.pop();
+			writer.write(next.first);
+			if (!readers[next.second].empty())
+			{
+				merge.push(merged_record(readers[next.second].front(), next.second));
+				readers[next.second].pop();
+			}
+		}
+		writer.flush();
+		if (fflush(file) != 0)
+		{
+			throw std::runtime_error("Failed writing " + file_name);
 		}
-		++solutions_presented;
 
-		std::cout << sol.first << ":" ;
-		sol.second.out();
-		std::cout << "\n";
-		solution_present(sol.second, players, values);
-		std::cout << "\n";
+		*messages << "Exported " << number_of_records << " solutions to " << file_name << "\n";
 	}
+	catch (...)
+	{
+		close_runs();
+		throw;
+	}
+	close_runs();
 }
 
-void remove_bom(std::string& line)
+/* Exported file mapped to memory, so queries don't need to read it whole */
+class exported_solutions
+{
+public:
+	explicit exported_solutions(const std::string& file_name)
+	{
+		descriptor = open(file_name.c_str(), O_RDONLY);
+		if (descriptor == -1)
+		{
+			throw std::runtime_error("Failed opening " + file_name);
+		}
+		struct stat file_stat;
+		if (fstat(descriptor, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < sizeof(header))
+		{
+			close(descriptor);
+			throw std::runtime_error(file_name + " is not exported solutions file");
+		}
+		size = file_stat.st_size;
+		void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		if (mapped == MAP_FAILED)
+		{
+			close(descriptor);
+			throw std::runtime_error("Failed mapping " + file_name + " to memory");
+		}
+		data = static_cast<const char*>(mapped);
+		memcpy(&header, data, sizeof(header));
+		if (memcmp(header.magic, export_file_magic, sizeof(header.magic)) != 0 ||
+				header.version != export_file_version ||
+				(size - sizeof(header)) % export_record_size != 0 ||
+				header.number_of_records != (size - sizeof(header)) / export_record_size)
+		{
+			munmap(mapped, size);
+			close(descriptor);
+			throw std::runtime_error(file_name + " is not exported solutions file or it is damaged");
+		}
+		records = data + sizeof(header);
+	}
+
+	~exported_solutions()
+	{
+		munmap(const_cast<char*>(data), size);
+		close(descriptor);
+	}
+
+	exported_solutions(const exported_solutions&) = delete;
+	exported_solutions& operator=(const exported_solutions&) = delete;
+
+	unsigned long long number_of_records() const
+	{
+		return header.number_of_records;
+	}
+
+	scored_solution record(unsigned long long index) const
+	{
+		return read_record(records + index * export_record_size);
+	}
+
+	/* Number of leading records with score at least min_score */
+	unsigned long long records_with_score_at_least(long long min_score) const
+	{
+		unsigned long long first = 0;
+		unsigned long long last = number_of_records();
+		while (first < last)
+		{
+			const unsigned long long middle = first + (last - first) / 2;
+			if (record(middle).first >= min_score)
+			{
+				first = middle + 1;
+			}
+			else
+			{
+				last = middle;
+			}
+		}
+		return first;
+	}
+
+	const export_file_header& get_header() const
+	{
+		return header;
+	}
+
+private:
+	int descriptor = -1;
+	size_t size = 0;
+	const char* data = nullptr;
+	const char* records = nullptr;
+	export_file_header header;
+};
+
+void run_query(const query_options& options)
 {
-	if (line[0] == '\xef' && line[1] == '\xbb' && line[2] == '\xbf')
+	const exported_solutions solutions(options.file);
+	const auto& header = solutions.get_header();
+	*messages << "Solutions with " << header.number_of_raid_times <<
+		(header.number_of_raid_times > 1 ? " raid times " : " raid time ") <<
+		"guild reset in timezone for results is at " << header.hour_of_master_activities_reset << ":30" << "\n";
+
+	const roster no_players;
+	const single_player_value_lookup_table no_values;
+	result_writer writer(std::cout, options.format, no_players, no_values);
+
+	const unsigned int included = options.included.get_data();
+	const unsigned int excluded = options.excluded.get_data();
+	const unsigned long long end = solutions.records_with_score_at_least(options.min_score);
+	unsigned int found = 0;
+	for (unsigned long long i = 0; i < end && found < options.top; ++i)
 	{
-		line = line.substr(3);
+		const auto sol = solutions.record(i);
+		const unsigned int hours = sol.second.get_data();
+		if ((hours & included) == included && (hours & excluded) == 0)
+		{
+			writer.solution(sol.first, sol.second);
+			++found;
+		}
 	}
+	writer.flush();
 }
 
-int main()
+/*****************************************************************************/
+
+void announce_raid(const config_header& header)
+{
+	phase_timer timer(run_statistics::printing);
+	*messages << "Will try to find " << header.number_of_raid_times <<
+		(header.number_of_raid_times > 1 ? " optimal raid times " : " optimal raid time ") <<
+		"guild reset in timezone for results is at " << header.hour_of_master_activities_reset << ":30" << "\n";
+	if (DEBUG) header.out(std::cout);
+}
+
+int main(int argc, char* argv[])
 {
-	std::vector<player> players;
-	config_header_parser header;
+	program_options options;
+	roster players;
+	// Input is typed by the user, so whitespace is that of his locale
+	const std::locale user_locale("");
+	config_header_parser header(user_locale);
 	unsigned int line_no = 0;
 	std::string line;
 
 	try
 	{
+		if (argc > 1 && std::string(argv[1]) == "query")
+		{
+			query_options query;
+			query.parse(argc, argv);
+			if (query.format != text_output)
+			{
+				messages = &std::cerr;
+			}
+			run_query(query);
+			return 0;
+		}
+
+		options.parse(argc, argv);
+		if (options.format != text_output)
+		{
+			messages = &std::cerr;
+		}
+		if (options.statistics)
+		{
+			stats.start();
+		}
+
+		phase_timer parse_timer(run_statistics::parse);
 		while (header.parsed() == false && std::getline(std::cin, line).good())
 		{
 			remove_bom(line);
 			++line_no;
-			if (is_comment(line))
+			if (is_comment(line, user_locale))
 			{
 				continue;
 			}
 			header.parse(line);
 		}
+		if (!header.parsed())
+		{
+			throw std::runtime_error("Input has no complete header");
+		}
 
-		std::cout << "Will try to find " << header.number_of_raid_times <<
-			(header.number_of_raid_times > 1 ? " optimal raid times " : " optimal raid time ") <<
-			"guild reset in timezone for results is at " << header.hour_of_master_activities_reset << ":30" << "\n";
-		if (DEBUG) header.out();
+		announce_raid(header);
 
+		// Headers of further raids may follow the first one, before members
+		std::vector<config_header_parser> further_raids;
 		while (std::getline(std::cin, line).good())
 		{
 			remove_bom(line);
 			++line_no;
-			if (is_comment(line))
+			if (is_comment(line, user_locale))
+			{
+				continue;
+			}
+			if (players.empty() && (config_header_parser::is_header_line(line, user_locale) ||
+						(!further_raids.empty() && !further_raids.back().parsed())))
 			{
+				if (further_raids.empty() || further_raids.back().parsed())
+				{
+					further_raids.push_back(config_header_parser(user_locale));
+				}
+				further_raids.back().parse(line);
+				if (further_raids.back().parsed())
+				{
+					announce_raid(further_raids.back());
+				}
 				continue;
 			}
-			player_parser p(line, header);
-			players.push_back(p);
-			players.back().out();
+			player_parser p(line, header, user_locale);
+			players.add(p);
+			phase_timer timer(run_statistics::printing);
+			for (const auto& warning : p.warnings)
+			{
+				*messages << warning << "\n";
+			}
+			p.out(*messages);
 		}
+		phase_timer calculation_timer(run_statistics::other);
 
-		calculate_results(header, players);
+		const bool weekly = players.weekly();
+		if (options.engine_chosen && options.engine && (!further_raids.empty() || weekly || !options.export_file.empty() || options.anytime_search()))
+		{
+			throw std::runtime_error("Engine can be chosen only for single raid without weekly calendar, export or anytime search");
+		}
+		if (options.top && (weekly || !options.export_file.empty()))
+		{
+			throw std::runtime_error("Top can't be chosen for weekly calendar or export");
+		}
+		if (options.impact && (options.engine || options.top || !further_raids.empty() || weekly || !options.export_file.empty() || options.anytime_search()))
+		{
+			throw std::runtime_error("Impact report is supported only for single raid without weekly calendar, export, anytime search, engine or top");
+		}
+		if (!further_raids.empty())
+		{
+			if (!further_raids.back().parsed())
+			{
+				throw std::runtime_error("Header of the last raid is not complete");
+			}
+			if (weekly || !options.export_file.empty() || options.anytime_search())
+			{
+				throw std::runtime_error("Weekly calendar, export and anytime search are not supported for several raids");
+			}
+			std::vector<config_header> raids(1, header);
+			raids.insert(raids.end(), further_raids.begin(), further_raids.end());
+			calculate_joint_results(raids, players, options.shared_hours, options.format, options.solutions_to_present());
+		}
+		else if (weekly)
+		{
+			if (!options.export_file.empty() || options.anytime_search())
+			{
+				throw std::runtime_error("Export and anytime search are not supported for weekly calendar");
+			}
+			calculate_week_results(header, players, options.format);
+		}
+		else if (!options.export_file.empty())
+		{
+			export_results(header, players, options.export_file);
+		}
+		else if (options.impact)
+		{
+			calculate_impact(header, players, options.format);
+		}
+		else if (options.anytime_search())
+		{
+			calculate_results_anytime(header, players, options, options.format, options.solutions_to_present());
+		}
+		else if (options.engine)
+		{
+			calculate_results_with_engine(header, players, *options.engine, options.format, options.solutions_to_present());
+		}
+		else
+		{
+			calculate_results(header, players, options.format, options.solutions_to_present());
+		}
 	}
 	catch (parse_error& e)
 	{
@@ -955,6 +2064,10 @@ int main()
 	catch (...)
 	{
 		std::cerr << "Oops at line " << line_no << std::endl;
+	}
+	if (stats.enabled)
+	{
+		stats.out(std::cerr);
 	}
 		//std::stoi(line, number_of_raid_times);
 	return 0;
@@ -0,0 +1,1979 @@
+#include "raid_solver_internal.hpp"
+
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <sstream>
+
+#if USE_GLIB_FOR_UTF8
+#include <glib.h>
+#endif
+
+/*****************************************************************************/
+// UTF related stuff
+
+#if USE_GLIB_FOR_UTF8
+
+/* Glib has own UTF implementation which seems to behave much better than gnu
+ * libc I am lazy so I don't use in place checking. Also any right to left
+ * issues are completly ignored in this function.
+ */
+size_t console_width(const std::string& line)
+{
+	glong items_read = 0;
+	glong items_written = 0;
+	GError* error = nullptr;
+	auto ucs4string = g_utf8_to_ucs4(line.c_str(), line.size(), &items_read, &items_written, &error);
+	if (ucs4string == nullptr)
+	{
+		return std::string::npos;
+	}
+
+	size_t width = 0;
+
+	for (size_t position = 0; position < items_written; ++position)
+	{
+		if (g_unichar_iswide(ucs4string[position]))
+		{
+			width += 2;
+			continue;
+		}
+		if (g_unichar_iszerowidth(ucs4string[position]))
+		{
+			continue;
+		}
+		width += 1;
+	}
+	g_free(ucs4string);
+	return width;
+}
+
+#elif TRUST_WCSWIDTH
+
+/* POSIX provides wcswidth, which should work correctly, but does not, and it
+ * requires conversion from UTF-8 to wide characters.
+ * Of coures we don't deal with right to left issues here too.
+ */
+size_t console_width(const std::string& line)
+{
+	wchar_t*  buffer = new wchar_t[line.size()];
+	mbstowcs(buffer, line.c_str(), line.size());
+	int width = wcswidth(buffer, line.size());
+	delete[] buffer;
+	if (width != -1 )
+	{
+		return width;
+	}
+	return std::string::npos;
+}
+
+#else // Lack of library support for UTF
+
+size_t console_width(const std::string& /*line*/)
+{
+	return std::string::npos;
+}
+
+#endif // USE_GLIB_FOR_UTF8 | TRUST_WCSWIDT | Lack of library support for UTF
+
+std::string spacer(const std::string& line, size_t position)
+{
+	if (position == std::string::npos)
+	{
+		position = line.size();
+	}
+	std::string to_measure = line.substr(0, position);
+	size_t width = console_width(to_measure);
+	if (width == std::string::npos)
+	{
+		return to_measure;
+	}
+	return std::string(width, ' ');
+}
+/*****************************************************************************/
+// Parsing helpers
+
+size_t next_not_white_position(const std::string& line, size_t position, const std::locale& locale)
+{
+	while (position < line.size() && std::isspace(line[position], locale))
+	{
+		++position;
+	}
+	if (position == line.size())
+	{
+		position = std::string::npos;
+	}
+	return position;
+}
+
+size_t previous_not_white_position(const std::string& line, size_t position, const std::locale& locale)
+{
+	while (position < line.size() && std::isspace(line[position], locale))
+	{
+		--position;
+	}
+	if (position == line.size())
+	{
+		position = std::string::npos;
+	}
+	return position;
+}
+
+bool is_comment(const std::string& line, const std::locale& locale)
+{
+	if (line.empty())
+	{
+		return true;
+	}
+	if (line[0] == '#')
+	{
+		return true;
+	}
+	if (next_not_white_position(line, 0, locale) == std::string::npos)
+	{
+		return true;
+	}
+	return false;
+}
+
+void remove_bom(std::string& line)
+{
+	if (line[0] == '\xef' && line[1] == '\xbb' && line[2] == '\xbf')
+	{
+		line = line.substr(3);
+	}
+}
+
+int parse_int(const std::string& line, size_t& position, const std::string& name)
+{
+	size_t first_uncoverted = 0;
+	int number=0;
+	try
+	{
+		number = std::stoi(line.substr(position, line.size() - position), &first_uncoverted);
+	}
+	catch (std::exception& e)
+	{
+		throw parse_error(position + first_uncoverted, "Failed parsing of " + name + ", got following error: " + e.what());
+	}
+	position += first_uncoverted;
+	return number;
+	//DEBUG_LOG << "After parsing number\n" << POS_PRINT(line, position);
+}
+
+
+// Do nothing converter for parse_list_of_integers
+int void_converter(int value)
+{
+	return value;
+};
+
+unsigned int parse_guild_activities_reset_time(const std::string& line, size_t& position, const std::locale& locale)
+{
+	const auto colon_position = line.find_first_of(":", position);
+	if (colon_position == std::string::npos)
+	{
+		throw parse_error(position, "There shall be colon in guild reset time");
+	}
+
+	int guild_activities_reset_reset_hour = parse_int(line, position, "guild activities reset time");
+	if (guild_activities_reset_reset_hour < 0 || guild_activities_reset_reset_hour > 23)
+	{
+		throw parse_error(position, "Invalid guild reset hour, got " + std::to_string(guild_activities_reset_reset_hour) +
+				" which is not reasonable --- should be not negative and smaller than 24");
+	}
+
+	position = next_not_white_position(line, position, locale);
+	if (colon_position != position)
+	{
+		throw parse_error(position, "Garbage found between end of guild reset hour and colon");
+	}
+
+	// skip colon
+	++position;
+
+	int minutes = parse_int(line, position, "minutes of guild activities reset time");
+	if (minutes != 30)
+	{
+		throw parse_error(position, "Guild reset time must be exactly halfhour, but we found it at " + std::to_string(minutes) +
+				" after whole hour, is in non-standard time-zone in use?");
+	}
+
+	return guild_activities_reset_reset_hour;
+}
+
+unsigned int parse_unsigned(const std::string& name, const std::string& value)
+{
+	size_t first_unconverted = 0;
+	unsigned long number = 0;
+	try
+	{
+		number = std::stoul(value, &first_unconverted);
+	}
+	catch (std::exception&)
+	{
+		first_unconverted = 0;
+	}
+	if (first_unconverted == 0 || first_unconverted != value.size() || value[0] == '-' ||
+			number > std::numeric_limits<unsigned int>::max())
+	{
+		throw std::runtime_error("Invalid value of " + name + ": " + value);
+	}
+	return number;
+}
+
+/*****************************************************************************/
+
+const char* const day_names[7] = {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
+
+std::string week_slot_label(unsigned int slot)
+{
+	return std::string(day_names[slot / 24]) + " " + std::to_string(slot % 24);
+}
+
+week_bitmap every_day_of_week(const time_bitmap& hours)
+{
+	week_bitmap week;
+	for (unsigned int day = 0; day < 7; ++day)
+	{
+		for (unsigned int hour = 0; hour < 24; ++hour)
+		{
+			week[day * 24 + hour] = hours.is_set(hour);
+		}
+	}
+	return week;
+}
+
+const std::string config_header_parser::raid_times_label = "Number of best raid times to seek:";
+const std::string config_header_parser::guild_reset_label = "Guild activities reset time for results:";
+const std::string config_header_parser::best_weights_label = "Best times weights list:";
+const std::string config_header_parser::acceptable_weights_label = "Acceptable times weights list:";
+
+player_parser::player_parser(const std::string& l, const config_header& header, const std::locale& loc) :
+	line(l),
+	config(header),
+	locale(loc)
+{
+	const auto first_coma_position = line.find_first_of(",");
+	if (first_coma_position == std::string::npos)
+	{
+		throw parse_error(0, "There shall be coma after player name ");
+	}
+
+	name_length = first_coma_position;
+
+	DEBUG_LOG << "Getting data for player " << line.substr(0, name_length) << "\n";
+	DEBUG_LOG << line.substr(first_coma_position + 1) << "\n";
+
+	auto coma_position = first_coma_position;
+	for (unsigned int i = 0; i < 3 && coma_position != std::string::npos; ++i)
+	{
+		coma_position = parse_single_command(coma_position);
+	}
+	if (coma_position != std::string::npos)
+	{
+		throw parse_error(coma_position, "Unexpected coma");
+	}
+
+	time_bitmap common_times = best_times_in_master_time & acceptable_times_in_master_time;
+	//common_times.data = best_times_in_master_time.data & acceptable_times_in_master_time.data;
+	if (common_times.get_data())
+	{
+		acceptable_times_in_master_time ^= common_times;
+		std::string warning = line.substr(0, name_length) + " has duplicate entry(ies) between best and acceptable list, removed from the latter: ";
+		for (unsigned int i = 0; i < 24; ++i)
+		{
+			if (common_times.is_set(i))
+			{
+				warning += std::to_string(i) + " ";
+			}
+		}
+		warnings.push_back(warning);
+	}
+
+	if (!weekly)
+	{
+		return;
+	}
+	best_times_in_master_week |= every_day_of_week(best_times_in_master_time);
+	acceptable_times_in_master_week |= every_day_of_week(acceptable_times_in_master_time);
+	const week_bitmap common_week_times = best_times_in_master_week & acceptable_times_in_master_week;
+	if (common_week_times.any())
+	{
+		acceptable_times_in_master_week &= ~common_week_times;
+		std::string warning = line.substr(0, name_length) + " has duplicate entry(ies) between best and acceptable list, removed from the latter: ";
+		for (unsigned int i = 0; i < hours_in_week; ++i)
+		{
+			if (common_week_times.test(i))
+			{
+				warning += week_slot_label(i) + " ";
+			}
+		}
+		warnings.push_back(warning);
+	}
+}
+
+size_t player_parser::parse_single_command(const size_t pre_command_coma_position)
+{
+	DEBUG_LOG << "Parsing single command \n";
+	const auto opening_brace_position = line.find_first_of("(", pre_command_coma_position + 1);
+
+	if (opening_brace_position == std::string::npos)
+	{
+		// Opening brace not found, but lets emit a bit different message
+		throw parse_error(pre_command_coma_position, "There shall be \"reset(\" or \"best(\" or \"acceptable\" after coma");
+	}
+
+	const auto command_start = next_not_white_position(line, pre_command_coma_position + 1, locale);
+	const auto command_end = previous_not_white_position(line, opening_brace_position - 1, locale);
+
+	const auto closing_brace_position = line.find_first_of(")", opening_brace_position);
+	if (closing_brace_position == std::string::npos)
+	{
+		throw parse_error(opening_brace_position, "There shall be closing brace after opening brace");
+	}
+
+
+	const std::string command = line.substr(command_start, command_end - command_start + 1);
+
+	DEBUG_LOG << "command: \"" << command << "\"\n";
+	DEBUG_LOG << "values: " << line.substr(opening_brace_position + 1, closing_brace_position - opening_brace_position - 1) << "\n";
+
+	const auto first_non_whitespace = next_not_white_position(line, closing_brace_position + 1, locale);
+	const auto post_command_coma_position = line.find_first_of(",", first_non_whitespace);
+
+	DEBUG_LOG << "initial coma" << POS_PRINT(line, pre_command_coma_position) ;
+	DEBUG_LOG << "opening brace" << POS_PRINT(line, opening_brace_position) ;
+	DEBUG_LOG << "closing brace " << POS_PRINT(line, closing_brace_position) ;
+	DEBUG_LOG << "first not white" << POS_PRINT(line, first_non_whitespace) ;
+	DEBUG_LOG << "following coma" << POS_PRINT(line, post_command_coma_position) ;
+
+	// Note that if first_non_whitespace is npos, then post_command_coma_position will be npos too
+	if (first_non_whitespace != post_command_coma_position)
+	{
+		throw parse_error(first_non_whitespace, "Found garbage after closing brace in command (is ther missing coma?)");
+	}
+
+	size_t position = opening_brace_position + 1;
+
+	if (command == "reset")
+	{
+		hour_of_guild_activities_reset_in_player_time = parse_guild_activities_reset_time(line, position, locale);
+		guild_activities_reset_reset_hour_was_set = true;
+
+		position = next_not_white_position(line, position, locale);
+		if (position != closing_brace_position)
+		{
+			throw parse_error(position, "Garbage found after guild reset time");
+		}
+	}
+	else if (command == "best")
+	{
+		parse_list_of_times(position, best_times_in_master_time, best_times_in_master_week, "best time", closing_brace_position);
+	}
+	else if (command == "acceptable")
+	{
+		parse_list_of_times(position, acceptable_times_in_master_time, acceptable_times_in_master_week, "acceptable time", closing_brace_position);
+	}
+	else
+	{
+		throw parse_error(command_start, "Unrecognized command: " + command);
+	}
+
+	return post_command_coma_position;
+}
+
+void player_parser::parse_list_of_times(size_t& position, time_bitmap& times, week_bitmap& week_times, const std::string& list_name, const size_t end_position)
+{
+	DEBUG_LOG << "parsing list of " << list_name << "s for " << line.substr(0, name_length) << "\n";
+	if (!guild_activities_reset_reset_hour_was_set)
+	{
+		throw parse_error(position, "List of " + list_name + "s found before guild activities reset time");
+	}
+
+	// If master time 18:30 is same as player time 19:30 then
+	// to convert from player to guild we need to distract 1
+	int diff = 24 + config.hour_of_master_activities_reset - hour_of_guild_activities_reset_in_player_time;
+
+	auto convert_int_to_time = [diff, &position, &list_name] (int local_time_hour) -> unsigned int
+	{
+		if (local_time_hour < 0 || local_time_hour > 24)
+		{
+			throw parse_error(position, "Invalid " + list_name + " hour, got " + std::to_string(local_time_hour) +
+					" which is not reasonable --- should be at least 0 and at most 24");
+		}
+		return (local_time_hour + diff) % 24;
+	};
+
+	const auto colon_position = line.find_first_of(":", position);
+	if (colon_position < end_position)
+	{
+		parse_list_of_week_times(position, week_times, list_name, end_position);
+		return;
+	}
+
+	std::vector<unsigned int> temporary_times;
+	parse_list_of_integers(line, position, temporary_times, list_name, end_position, convert_int_to_time, locale);
+
+	for (const auto time : temporary_times)
+	{
+		times.set(time);
+	}
+}
+
+void player_parser::parse_list_of_week_times(size_t& position, week_bitmap& times, const std::string& list_name, const size_t end_position)
+{
+	weekly = true;
+
+	// Reset times give only difference of timezones modulo 24 hours, we
+	// assume the one smaller than half of the day.
+	int diff = (24 + config.hour_of_master_activities_reset - hour_of_guild_activities_reset_in_player_time) % 24;
+	if (diff >= 12)
+	{
+		diff -= 24;
+	}
+
+	while (position < end_position)
+	{
+		const auto group_end = std::min(line.find_first_of(";", position), end_position);
+		const auto colon_position = line.find_first_of(":", position);
+		if (colon_position >= group_end)
+		{
+			throw parse_error(position, "There shall be colon between days and hours in list of " + list_name + "s");
+		}
+		const unsigned int days = parse_days(position, colon_position);
+		position = colon_position + 1;
+
+		auto check_hour = [&position, &list_name] (int local_time_hour) -> unsigned int
+		{
+			if (local_time_hour < 0 || local_time_hour > 24)
+			{
+				throw parse_error(position, "Invalid " + list_name + " hour, got " + std::to_string(local_time_hour) +
+						" which is not reasonable --- should be at least 0 and at most 24");
+			}
+			return local_time_hour;
+		};
+		std::vector<unsigned int> hours;
+		parse_list_of_integers(line, position, hours, list_name, group_end, check_hour, locale, ",;)");
+
+		for (unsigned int day = 0; day < 7; ++day)
+		{
+			if (days & (1u << day))
+			{
+				for (const auto hour : hours)
+				{
+					times.set((day * 24 + hour + diff + hours_in_week) % hours_in_week);
+				}
+			}
+		}
+
+		if (position < end_position)
+		{
+			// skip semicolon
+			++position;
+		}
+	}
+}
+
+unsigned int player_parser::parse_days(size_t position, const size_t end_position)
+{
+	const auto dash_position = line.find_first_of("-", position);
+	const unsigned int first_day = parse_day(position, std::min(dash_position, end_position));
+	if (dash_position > end_position)
+	{
+		return 1u << first_day;
+	}
+	const unsigned int last_day = parse_day(dash_position + 1, end_position);
+	unsigned int days = 0;
+	for (unsigned int day = first_day; ; day = (day + 1) % 7)
+	{
+		days |= 1u << day;
+		if (day == last_day)
+		{
+			break;
+		}
+	}
+	return days;
+}
+
+unsigned int player_parser::parse_day(const size_t position, const size_t end_position)
+{
+	const auto start = next_not_white_position(line, position, locale);
+	if (start >= end_position)
+	{
+		throw parse_error(position, "Expected day name (Mon, Tue, Wed, Thu, Fri, Sat or Sun)");
+	}
+	const auto end = previous_not_white_position(line, end_position - 1, locale);
+	const std::string day = line.substr(start, end - start + 1);
+	for (unsigned int i = 0; i < 7; ++i)
+	{
+		if (day == day_names[i])
+		{
+			return i;
+		}
+	}
+	throw parse_error(start, "Unrecognized day name: " + day + ", expected one of Mon, Tue, Wed, Thu, Fri, Sat or Sun");
+}
+
+/*****************************************************************************/
+// Roster
+
+void roster::add(const player_parser& p)
+{
+	if (p.weekly && !any_weekly)
+	{
+		any_weekly = true;
+		weeks.reserve(best.capacity());
+		for (size_t i = 0; i < best.size(); ++i)
+		{
+			weeks.push_back(week_calendar{every_day_of_week(best_times(i)), every_day_of_week(acceptable_times(i))});
+		}
+	}
+	best.push_back(p.best_times_in_master_time.get_data());
+	acceptable.push_back(p.acceptable_times_in_master_time.get_data());
+	name_offsets.push_back(names.size());
+	names.insert(names.end(), p.line.begin(), p.line.begin() + p.name_length);
+	names.push_back('\0');
+	if (p.weekly)
+	{
+		weeks.push_back(week_calendar{p.best_times_in_master_week, p.acceptable_times_in_master_week});
+	}
+	else if (any_weekly)
+	{
+		weeks.push_back(week_calendar{every_day_of_week(p.best_times_in_master_time), every_day_of_week(p.acceptable_times_in_master_time)});
+	}
+}
+
+void roster::clear()
+{
+	best.clear();
+	acceptable.clear();
+	names.clear();
+	name_offsets.clear();
+	weeks.clear();
+	any_weekly = false;
+}
+
+void roster::reserve(size_t players)
+{
+	best.reserve(players);
+	acceptable.reserve(players);
+	name_offsets.reserve(players);
+}
+
+/*****************************************************************************/
+// Scoring
+
+single_player_value_lookup_table build_value_lookup_table(const config_header& header)
+{
+	single_player_value_lookup_table values;
+	unsigned int best_sum = 0;
+	unsigned int acceptable_sum = 0;
+	values.best.push_back(best_sum);
+	values.acceptable.push_back(acceptable_sum);
+	for (unsigned int i = 0; i < header.number_of_raid_times; ++i)
+	{
+		if (i < header.best_weights.size())
+		{
+			best_sum += header.best_weights[i];
+		}
+		else if (header.best_weights.empty() == false)
+		{
+			best_sum += header.best_weights.back();
+		}
+		if (i < header.acceptable_weights.size())
+		{
+			acceptable_sum += header.acceptable_weights[i];
+		}
+		else if (header.best_weights.empty() == false)
+		{
+			acceptable_sum += header.acceptable_weights.back();
+		}
+		values.best.push_back(best_sum);
+		values.acceptable.push_back(acceptable_sum);
+	}
+	return values;
+}
+
+long long solution_value(const time_bitmap& solution, const roster& players, const single_player_value_lookup_table& values)
+{
+	const unsigned int hours = solution.get_data();
+	const unsigned int* best = players.best_masks();
+	const unsigned int* acceptable = players.acceptable_masks();
+	long long value = 0;
+	for (size_t i = 0; i < players.size(); ++i)
+	{
+		const unsigned int best_times = number_of_set_bits(best[i] & hours);
+		const unsigned int acceptable_times = number_of_set_bits(acceptable[i] & hours);
+		value += values.best[best_times];
+		value += values.acceptable[best_times + acceptable_times] - values.acceptable[best_times];
+		DEBUG_LOG << players.name(i) << " best(" << best_times << "), acceptable(" << acceptable_times << "), value(";
+		DEBUG_LOG << values.best[best_times] << " + " << values.acceptable[best_times + acceptable_times] - values.acceptable[best_times] << ")\n";
+	}
+	return value;
+}
+
+/* Weights may be arbitrary (even negative), so we simply check every count of
+ * best and acceptable hours which can be achieved.
+ */
+long long max_player_value(const single_player_value_lookup_table& values,
+		unsigned int chosen_best, unsigned int chosen_acceptable,
+		unsigned int available_best, unsigned int available_acceptable, unsigned int available_other,
+		unsigned int remaining_times)
+{
+	long long max_value = std::numeric_limits<long long>::min();
+	for (unsigned int best_times = 0; best_times <= available_best && best_times <= remaining_times; ++best_times)
+	{
+		for (unsigned int acceptable_times = 0; acceptable_times <= available_acceptable && best_times + acceptable_times <= remaining_times; ++acceptable_times)
+		{
+			if (remaining_times - best_times - acceptable_times > available_other)
+			{
+				continue;
+			}
+			const long long value = single_player_value(values, chosen_best + best_times, chosen_acceptable + acceptable_times);
+			max_value = std::max(max_value, value);
+		}
+	}
+	return max_value;
+}
+
+long long solution_value_upper_bound(const time_bitmap& available, unsigned int raid_times, const roster& players, const single_player_value_lookup_table& values)
+{
+	const unsigned int available_hours = number_of_set_bits(available.get_data());
+	long long bound = 0;
+	for (size_t i = 0; i < players.size(); ++i)
+	{
+		const unsigned int available_best = number_of_set_bits((players.best_times(i) & available).get_data());
+		const unsigned int available_acceptable = number_of_set_bits((players.acceptable_times(i) & available).get_data());
+		bound += max_player_value(values, 0, 0, available_best, available_acceptable,
+				available_hours - available_best - available_acceptable, raid_times);
+	}
+	return bound;
+}
+
+unsigned long long number_of_combinations(unsigned int n, unsigned int k)
+{
+	unsigned long long retval = 1;
+	for (unsigned int i = 1; i <= k; ++i)
+	{
+		retval = retval * (n - k + i) / i;
+	}
+	return retval;
+}
+
+/* all_solutions_iterator visits solutions in lexicographic order of sorted
+ * hours, which is the same as: from two solutions first is the one which has
+ * lowest of differing hours. Multimap keeps equal values in insertion order,
+ * so this is also order in which solutions of equal value are presented.
+ */
+bool is_enumerated_before(const time_bitmap& first, const time_bitmap& second)
+{
+	const unsigned int difference = first.get_data() ^ second.get_data();
+	return (difference & (~difference + 1) & first.get_data()) != 0;
+}
+
+bool is_presented_before(const scored_solution& first, const scored_solution& second)
+{
+	if (first.first != second.first)
+	{
+		return first.first > second.first;
+	}
+	return is_enumerated_before(first.second, second.second);
+}
+
+/*****************************************************************************/
+// Engines
+
+std::vector<preference_profile> distinct_preferences(const roster& players)
+{
+	// Best hours in low bits, acceptable ones in high bits
+	std::vector<unsigned long long> preferences;
+	preferences.reserve(players.size());
+	for (size_t i = 0; i < players.size(); ++i)
+	{
+		preferences.push_back(players.best_masks()[i] | static_cast<unsigned long long>(players.acceptable_masks()[i]) << 32);
+	}
+	std::sort(preferences.begin(), preferences.end());
+
+	std::vector<preference_profile> profiles;
+	for (size_t i = 0; i < preferences.size(); )
+	{
+		size_t j = i;
+		while (j < preferences.size() && preferences[j] == preferences[i])
+		{
+			++j;
+		}
+		const preference_profile profile = {static_cast<unsigned int>(preferences[i] & 0xffffffffu),
+			static_cast<unsigned int>(preferences[i] >> 32), static_cast<long long>(j - i)};
+		profiles.push_back(profile);
+		i = j;
+	}
+	return profiles;
+}
+
+player_gain_tables::player_gain_tables(const single_player_value_lookup_table& values, unsigned int raid_times) :
+	stride(raid_times + 1),
+	player_values(stride * stride, 0),
+	best_gains(stride * stride, 0),
+	acceptable_gains(stride * stride, 0)
+{
+	for (unsigned int best_times = 0; best_times <= raid_times; ++best_times)
+	{
+		for (unsigned int acceptable_times = 0; best_times + acceptable_times <= raid_times; ++acceptable_times)
+		{
+			const unsigned int position = index(best_times, acceptable_times);
+			player_values[position] = single_player_value(values, best_times, acceptable_times);
+			if (best_times + acceptable_times < raid_times)
+			{
+				best_gains[position] = single_player_value(values, best_times + 1, acceptable_times) - player_values[position];
+				acceptable_gains[position] = single_player_value(values, best_times, acceptable_times + 1) - player_values[position];
+			}
+		}
+	}
+	for (unsigned int best_times = 0; best_times <= raid_times; ++best_times)
+	{
+		for (unsigned int acceptable_times = 0; best_times + acceptable_times + 2 <= raid_times; ++acceptable_times)
+		{
+			const unsigned int position = index(best_times, acceptable_times);
+			for (const unsigned int next : {position + stride, position + 1})
+			{
+				diminishing_gains = diminishing_gains && best_gains[next] <= best_gains[position] &&
+					acceptable_gains[next] <= acceptable_gains[position];
+			}
+		}
+	}
+}
+
+unsigned long long solve_by_enumeration(const config_header& header, const roster& players, size_t max_solutions, std::vector<scored_solution>& results)
+{
+	const auto values = build_value_lookup_table(header);
+	top_solutions top(results, max_solutions);
+	auto it = all_solutions_iterator::begin(header.number_of_raid_times);
+	const auto end = all_solutions_iterator::end(header.number_of_raid_times);
+	for (; it != end; ++it)
+	{
+		top.add(solution_value(*it, players, values), *it);
+	}
+	top.finish();
+	return number_of_combinations(24, header.number_of_raid_times);
+}
+
+/* Hours are split into high block (12-23) and low block (0-11), every solution
+ * is combination of high hours completed with combination of low hours. For
+ * each high combination counts of best and acceptable hours in high block are
+ * computed once per player and the inner loop over low combinations adds only
+ * counts of low block, which are looked up in table of 12 bit popcounts
+ * instead of being counted. Counts are packed into single index of table of
+ * player values, so each player costs two lookups, addition and one more
+ * lookup. Players with the same preferences are scored once, multiplied by
+ * their number, and those without any preference in low block add the same
+ * value to every low combination, so they are summed only once per high one.
+ */
+unsigned long long solve_nested(const config_header& header, const roster& players, size_t max_solutions, std::vector<scored_solution>& results)
+{
+	const unsigned int raid_times = header.number_of_raid_times;
+	const unsigned int block_size = 12;
+	const unsigned int block_mask = (1u << block_size) - 1;
+	const auto values = build_value_lookup_table(header);
+
+	const player_gain_tables tables(values, raid_times);
+
+	std::vector<unsigned char> block_popcount(1u << block_size);
+	std::vector<std::vector<unsigned int> > block_combinations(block_size + 1);
+	for (unsigned int mask = 0; mask <= block_mask; ++mask)
+	{
+		block_popcount[mask] = number_of_set_bits(mask);
+		block_combinations[block_popcount[mask]].push_back(mask);
+	}
+
+	// Profiles with some preference in low block are active, the others passive
+	std::vector<unsigned int> low_best, low_acceptable, high_best, high_acceptable;
+	std::vector<long long> count;
+	std::vector<unsigned int> passive_high_best, passive_high_acceptable;
+	std::vector<long long> passive_count;
+	for (const auto& profile : distinct_preferences(players))
+	{
+		if ((profile.best | profile.acceptable) & block_mask)
+		{
+			low_best.push_back(profile.best & block_mask);
+			low_acceptable.push_back(profile.acceptable & block_mask);
+			high_best.push_back(profile.best >> block_size);
+			high_acceptable.push_back(profile.acceptable >> block_size);
+			count.push_back(profile.count);
+		}
+		else
+		{
+			passive_high_best.push_back(profile.best >> block_size);
+			passive_high_acceptable.push_back(profile.acceptable >> block_size);
+			passive_count.push_back(profile.count);
+		}
+	}
+
+	const size_t active = count.size();
+	std::vector<unsigned int> high_index(active);
+	top_solutions top(results, max_solutions);
+	const unsigned int min_high_times = raid_times > block_size ? raid_times - block_size : 0;
+	const unsigned int max_high_times = std::min(raid_times, block_size);
+	for (unsigned int high_times = min_high_times; high_times <= max_high_times; ++high_times)
+	{
+		for (const unsigned int high : block_combinations[high_times])
+		{
+			long long passive_value = 0;
+			for (size_t g = 0; g < passive_count.size(); ++g)
+			{
+				passive_value += passive_count[g] * tables.player_values[block_popcount[passive_high_best[g] & high] * tables.stride +
+					block_popcount[passive_high_acceptable[g] & high]];
+			}
+			for (size_t g = 0; g < active; ++g)
+			{
+				high_index[g] = block_popcount[high_best[g] & high] * tables.stride + block_popcount[high_acceptable[g] & high];
+			}
+
+			for (const unsigned int low : block_combinations[raid_times - high_times])
+			{
+				long long value = passive_value;
+				for (size_t g = 0; g < active; ++g)
+				{
+					value += count[g] * tables.player_values[high_index[g] + block_popcount[low_best[g] & low] * tables.stride +
+						block_popcount[low_acceptable[g] & low]];
+				}
+				top.add(value, time_bitmap(low | high << block_size));
+			}
+		}
+	}
+	top.finish();
+	return number_of_combinations(24, raid_times);
+}
+
+unsigned long long solve_best_first(const config_header& header, const roster& players, size_t max_solutions, std::vector<scored_solution>& results)
+{
+	best_first_generator generator(header, players);
+	results.clear();
+	results.reserve(max_solutions);
+	scored_solution solution;
+	while (results.size() < max_solutions && generator.next(solution))
+	{
+		results.push_back(solution);
+	}
+	return generator.nodes_bounded();
+}
+
+best_first_generator::best_first_generator(const config_header& header, const roster& players) :
+	raid_times(header.number_of_raid_times),
+	values(build_value_lookup_table(header)),
+	profiles(distinct_preferences(players)),
+	tables(values, raid_times)
+{
+	for (const auto& profile : profiles)
+	{
+		empty_solution_value += profile.count * tables.player_values[0];
+		for (unsigned int hour = 0; hour < 24; ++hour)
+		{
+			empty_solution_gains[hour] += profile.count * ((profile.best >> hour & 1) * tables.best_gains[0] + (profile.acceptable >> hour & 1) * tables.acceptable_gains[0]);
+		}
+	}
+	push(time_bitmap(), 0, 0);
+}
+
+bool best_first_generator::next(scored_solution& solution)
+{
+	while (!frontier.empty())
+	{
+		const node n = frontier.top();
+		frontier.pop();
+		if (n.next_hour == 24)
+		{
+			solution = scored_solution(n.bound, n.included);
+			return true;
+		}
+		time_bitmap with_hour = n.included;
+		with_hour.set(n.next_hour);
+		push(with_hour, n.next_hour + 1, n.included_times + 1);
+		push(n.included, n.next_hour + 1, n.included_times);
+	}
+	return false;
+}
+
+/* Partial solution which can be completed in single way is completed right
+ * away, so only complete solutions have next_hour 24 and their bound is value.
+ */
+void best_first_generator::push(time_bitmap included, unsigned int next_hour, unsigned int included_times)
+{
+	if (included_times == raid_times)
+	{
+		next_hour = 24;
+	}
+	else if (24 - next_hour == raid_times - included_times)
+	{
+		for (; next_hour < 24; ++next_hour)
+		{
+			included.set(next_hour);
+		}
+		included_times = raid_times;
+	}
+
+	node n;
+	n.included = included;
+	n.next_hour = next_hour;
+	n.included_times = included_times;
+	n.first_completion = included;
+	for (unsigned int hour = next_hour; hour < next_hour + raid_times - included_times; ++hour)
+	{
+		n.first_completion.set(hour);
+	}
+
+	const unsigned int remaining_times = raid_times - included_times;
+	const unsigned int available = next_hour < 24 ? 0xffffffu & ~((1u << next_hour) - 1) : 0;
+	const unsigned int available_hours = 24 - next_hour;
+	long long value = 0;
+	long long players_bound = 0;
+	long long hour_gains[24] = {0};
+	for (const auto& profile : profiles)
+	{
+		const unsigned int chosen_best = number_of_set_bits(profile.best & included.get_data());
+		const unsigned int chosen_acceptable = number_of_set_bits(profile.acceptable & included.get_data());
+		const unsigned int index = tables.index(chosen_best, chosen_acceptable);
+		value += profile.count * tables.player_values[index];
+		if (remaining_times == 0)
+		{
+			continue;
+		}
+		if (tables.diminishing_gains)
+		{
+			for (unsigned int hours = profile.best & available; hours; hours &= hours - 1)
+			{
+				hour_gains[lowest_set_bit(hours)] += profile.count * tables.best_gains[index];
+			}
+			for (unsigned int hours = profile.acceptable & available; hours; hours &= hours - 1)
+			{
+				hour_gains[lowest_set_bit(hours)] += profile.count * tables.acceptable_gains[index];
+			}
+			continue;
+		}
+		const unsigned int available_best = number_of_set_bits(profile.best & available);
+		const unsigned int available_acceptable = number_of_set_bits(profile.acceptable & available);
+		players_bound += profile.count * max_player_value(values, chosen_best, chosen_acceptable, available_best, available_acceptable,
+				available_hours - available_best - available_acceptable, remaining_times);
+	}
+
+	if (remaining_times == 0)
+	{
+		n.bound = value;
+	}
+	else if (tables.diminishing_gains)
+	{
+		long long* const gains = hour_gains + next_hour;
+		std::partial_sort(gains, gains + remaining_times, hour_gains + 24, std::greater<long long>());
+		n.bound = value;
+		for (unsigned int i = 0; i < remaining_times; ++i)
+		{
+			n.bound += gains[i];
+		}
+	}
+	else
+	{
+		n.bound = players_bound;
+	}
+	++bounded;
+	frontier.push(n);
+}
+
+const solver_engine solver_engines[] = {
+	{"enumeration", "scores every solution in order of all_solutions_iterator", solve_by_enumeration},
+	{"nested", "two level enumeration, counts of high block of hours shared by all low completions", solve_nested},
+	{"best_first", "best-first search with upper bounds, searches only as much as needed", solve_best_first},
+};
+
+const size_t number_of_solver_engines = sizeof(solver_engines) / sizeof(solver_engines[0]);
+
+const solver_engine* find_solver_engine(const std::string& name)
+{
+	for (size_t i = 0; i < number_of_solver_engines; ++i)
+	{
+		if (name == solver_engines[i].name)
+		{
+			return &solver_engines[i];
+		}
+	}
+	return nullptr;
+}
+
+/*****************************************************************************/
+// Joint optimization of several raids
+
+bool is_joint_presented_before(const joint_solution& first, const joint_solution& second)
+{
+	if (first.value != second.value)
+	{
+		return first.value > second.value;
+	}
+	for (size_t i = 0; i < first.raids.size(); ++i)
+	{
+		if (first.raids[i].second.get_data() != second.raids[i].second.get_data())
+		{
+			return is_enumerated_before(first.raids[i].second, second.raids[i].second);
+		}
+	}
+	return false;
+}
+
+/* Solutions of single raid pulled from its generator so far, deque keeps them
+ * in place, so search refers to them by pointers. Raids with equal values of
+ * players share one stream.
+ */
+struct raid_stream
+{
+	static const size_t block_size = 64;
+
+	unsigned int raid_times;
+	std::unique_ptr<best_first_generator> generator;
+	std::deque<scored_solution> solutions;
+	// Hours included in every solution of each block of block_size solutions
+	std::vector<unsigned int> common_hours;
+
+	/* Solution of given rank, nullptr when there are fewer solutions */
+	const scored_solution* solution(size_t rank)
+	{
+		scored_solution sol;
+		while (solutions.size() <= rank && generator->next(sol))
+		{
+			if (solutions.size() % block_size == 0)
+			{
+				common_hours.push_back(0xffffffu);
+			}
+			common_hours.back() &= sol.second.get_data();
+			solutions.push_back(sol);
+		}
+		return rank < solutions.size() ? &solutions[rank] : nullptr;
+	}
+
+	/* Whether block starts at given rank, all its solutions were pulled and
+	 * each of them includes some of given hours
+	 */
+	bool block_overlaps(size_t rank, unsigned int hours) const
+	{
+		return rank % block_size == 0 && rank + block_size <= solutions.size() && (common_hours[rank / block_size] & hours);
+	}
+};
+
+class joint_search
+{
+public:
+	joint_search(const std::vector<raid_stream*>& r, bool shared, size_t max_solutions) :
+		raids(r),
+		shared_hours(shared),
+		diminishing_gains(std::all_of(r.begin(), r.end(), [] (const raid_stream* raid) { return raid->generator->has_diminishing_gains(); })),
+		limit(max_solutions),
+		best_of_remaining(r.size() + 1, 0),
+		previous_equal(r.size(), r.size()),
+		chosen(r.size(), nullptr)
+	{
+		for (size_t i = raids.size(); i-- > 0;)
+		{
+			const scored_solution* sol = raids[i]->solution(0);
+			best_of_remaining[i] = best_of_remaining[i + 1] + (sol ? sol->first : 0);
+		}
+		for (size_t i = 0; i < raids.size(); ++i)
+		{
+			for (size_t j = i; j-- > 0;)
+			{
+				if (raids[j] == raids[i])
+				{
+					previous_equal[i] = j;
+					break;
+				}
+			}
+			if (previous_equal[i] != raids.size())
+			{
+				continue;
+			}
+			std::vector<size_t> group;
+			for (size_t j = i; j < raids.size(); ++j)
+			{
+				if (raids[j] == raids[i])
+				{
+					group.push_back(j);
+				}
+			}
+			if (group.size() > 1)
+			{
+				groups.push_back(group);
+			}
+		}
+	}
+
+	void solve(std::vector<joint_solution>& results)
+	{
+		best.clear();
+		if (limit > 0)
+		{
+			find_threshold();
+			search(0, 0, 0);
+		}
+		std::sort_heap(best.begin(), best.end(), is_candidate_presented_before);
+		results.clear();
+		results.reserve(best.size());
+		for (const auto& candidate : best)
+		{
+			joint_solution solution;
+			solution.value = candidate.value;
+			for (const auto sol : candidate.raids)
+			{
+				solution.raids.push_back(*sol);
+			}
+			results.push_back(solution);
+		}
+	}
+
+private:
+	struct candidate
+	{
+		long long value;
+		std::vector<const scored_solution*> raids;
+	};
+
+	static const long long no_completion = std::numeric_limits<long long>::min();
+	// Solutions scanned by find_threshold per presented one
+	static const size_t threshold_scan_factor = 64;
+
+	const std::vector<raid_stream*> raids;
+	const bool shared_hours;
+	const bool diminishing_gains;
+	const size_t limit;
+	// Sum of best values of raids from given one to the last
+	std::vector<long long> best_of_remaining;
+	// Previous raid sharing the stream, raids.size() when there is none
+	std::vector<size_t> previous_equal;
+	// Raids sharing a stream, only groups of more raids
+	std::vector<std::vector<size_t>> groups;
+	std::vector<const scored_solution*> chosen;
+	// Heap with the last presented one on top
+	std::vector<candidate> best;
+	// Value some limit combinations reach, so lower ones are pruned before
+	// the heap is full
+	long long threshold = std::numeric_limits<long long>::min();
+
+	/* Equal solutions of a raid are the same object of its stream */
+	static bool is_candidate_presented_before(const candidate& first, const candidate& second)
+	{
+		if (first.value != second.value)
+		{
+			return first.value > second.value;
+		}
+		for (size_t i = 0; i < first.raids.size(); ++i)
+		{
+			if (first.raids[i] != second.raids[i])
+			{
+				return is_enumerated_before(first.raids[i]->second, second.raids[i]->second);
+			}
+		}
+		return false;
+	}
+
+	static bool is_solution_enumerated_before(const scored_solution* first, const scored_solution* second)
+	{
+		return is_enumerated_before(first->second, second->second);
+	}
+
+	/* Upper bound of values of raids from given one to the last, when they
+	 * can use only free hours, no_completion when there are too few of them
+	 */
+	long long remaining_bound(size_t raid, unsigned int free_hours) const
+	{
+		const long long bound = best_of_remaining[raid];
+		if (shared_hours || !diminishing_gains || raid == raids.size())
+		{
+			return bound;
+		}
+		// Each raid takes its best gains of free hours, and all of them
+		// together take the best gains of free hours among raids
+		long long separate = 0;
+		long long together = 0;
+		unsigned int raid_times = 0;
+		long long gains[24];
+		long long best_gains[24];
+		unsigned int free_count = 0;
+		for (unsigned int hour = 0; hour < 24; ++hour)
+		{
+			if (free_hours >> hour & 1)
+			{
+				best_gains[free_count++] = std::numeric_limits<long long>::min();
+			}
+		}
+		for (size_t i = raid; i < raids.size(); ++i)
+		{
+			const auto& generator = *raids[i]->generator;
+			const unsigned int times = raids[i]->raid_times;
+			raid_times += times;
+			if (free_count < raid_times)
+			{
+				return no_completion;
+			}
+			for (unsigned int hour = 0, j = 0; hour < 24; ++hour)
+			{
+				if (free_hours >> hour & 1)
+				{
+					gains[j] = generator.hour_gain(hour);
+					best_gains[j] = std::max(best_gains[j], gains[j]);
+					++j;
+				}
+			}
+			std::partial_sort(gains, gains + times, gains + free_count, std::greater<long long>());
+			separate += generator.empty_value() + std::accumulate(gains, gains + times, 0LL);
+			together += generator.empty_value();
+		}
+		std::partial_sort(best_gains, best_gains + raid_times, best_gains + free_count, std::greater<long long>());
+		together += std::accumulate(best_gains, best_gains + raid_times, 0LL);
+		return std::min(bound, std::min(separate, together));
+	}
+
+	/* Whether no combination of chosen solutions of raids before given one,
+	 * solution sol of the raid and any solutions of following raids with value
+	 * at most bound can be presented
+	 */
+	bool cannot_be_presented(size_t raid, const scored_solution& sol, long long bound) const
+	{
+		if (best.size() < limit)
+		{
+			return bound < threshold;
+		}
+		const candidate& worst = best.front();
+		if (bound != worst.value)
+		{
+			return bound < worst.value;
+		}
+		for (size_t i = 0; i < raid; ++i)
+		{
+			if (chosen[i] != worst.raids[i])
+			{
+				return is_enumerated_before(worst.raids[i]->second, chosen[i]->second);
+			}
+		}
+		return &sol != worst.raids[raid] && is_enumerated_before(worst.raids[raid]->second, sol.second);
+	}
+
+	/* Sets threshold to the lowest value of the first limit combinations
+	 * found by taking best solutions of each raid, unless scanning them takes
+	 * too long
+	 */
+	void find_threshold()
+	{
+		size_t found = 0;
+		size_t budget = threshold_scan_factor * limit;
+		long long lowest = std::numeric_limits<long long>::max();
+		scan(0, 0, 0, found, budget, lowest);
+		if (found == limit)
+		{
+			threshold = lowest;
+		}
+	}
+
+	void scan(size_t raid, long long value, unsigned int used_hours, size_t& found, size_t& budget, long long& lowest)
+	{
+		if (raid == raids.size())
+		{
+			++found;
+			lowest = std::min(lowest, value);
+			return;
+		}
+		for (size_t rank = 0; found < limit && budget > 0; ++rank, --budget)
+		{
+			const scored_solution* sol = raids[raid]->solution(rank);
+			if (!sol)
+			{
+				return;
+			}
+			const unsigned int hours = sol->second.get_data();
+			if (shared_hours || !(hours & used_hours))
+			{
+				scan(raid + 1, value + sol->first, used_hours | hours, found, budget, lowest);
+			}
+		}
+	}
+
+	void search(size_t raid, long long value, unsigned int used_hours)
+	{
+		if (raid == raids.size())
+		{
+			record(value);
+			return;
+		}
+		const unsigned int free_hours = 0xffffffu & ~used_hours;
+		const long long following_bound = remaining_bound(raid + 1, free_hours);
+		if (following_bound == no_completion)
+		{
+			return;
+		}
+		const size_t previous = previous_equal[raid];
+		for (size_t rank = 0; const scored_solution* sol = raids[raid]->solution(rank); ++rank)
+		{
+			// Best solutions often share popular hours, so a block of them
+			// can be skipped at once
+			if (!shared_hours && raids[raid]->block_overlaps(rank, used_hours))
+			{
+				rank += raid_stream::block_size - 1;
+				continue;
+			}
+			// Solutions come in order of presentation, so all following ones
+			// have lower value or the same one and come later
+			if (cannot_be_presented(raid, *sol, value + sol->first + following_bound))
+			{
+				return;
+			}
+			// Raids sharing a stream take its solutions in enumeration order,
+			// which is the first of their arrangements, the other ones are
+			// recorded with it
+			if (previous != raids.size() && sol != chosen[previous] && !is_solution_enumerated_before(chosen[previous], sol))
+			{
+				continue;
+			}
+			const unsigned int hours = sol->second.get_data();
+			if (!shared_hours && (hours & used_hours))
+			{
+				continue;
+			}
+			if (!shared_hours)
+			{
+				const long long bound = remaining_bound(raid + 1, free_hours & ~hours);
+				if (bound == no_completion || cannot_be_presented(raid, *sol, value + sol->first + bound))
+				{
+					continue;
+				}
+			}
+			chosen[raid] = sol;
+			search(raid + 1, value + sol->first, used_hours | hours);
+		}
+	}
+
+	void record(long long value)
+	{
+		candidate solution;
+		solution.value = value;
+		solution.raids = chosen;
+		record_arrangements(solution, 0);
+	}
+
+	/* Records every distinct arrangement of solutions of raids sharing a
+	 * stream, starting with given group
+	 */
+	void record_arrangements(candidate& solution, size_t group)
+	{
+		if (group == groups.size())
+		{
+			insert(solution);
+			return;
+		}
+		const auto& members = groups[group];
+		std::vector<const scored_solution*> sols;
+		for (const auto raid : members)
+		{
+			sols.push_back(chosen[raid]);
+		}
+		do
+		{
+			for (size_t i = 0; i < members.size(); ++i)
+			{
+				solution.raids[members[i]] = sols[i];
+			}
+			record_arrangements(solution, group + 1);
+		}
+		while (std::next_permutation(sols.begin(), sols.end(), is_solution_enumerated_before));
+	}
+
+	void insert(const candidate& solution)
+	{
+		if (best.size() == limit)
+		{
+			if (!is_candidate_presented_before(solution, best.front()))
+			{
+				return;
+			}
+			std::pop_heap(best.begin(), best.end(), is_candidate_presented_before);
+			best.pop_back();
+		}
+		best.push_back(solution);
+		std::push_heap(best.begin(), best.end(), is_candidate_presented_before);
+	}
+};
+
+unsigned long long solve_joint(const std::vector<config_header>& headers, const roster& players, bool shared_hours,
+		size_t max_solutions, std::vector<joint_solution>& results)
+{
+	// Hours of players are in timezone of the first raid, so raids with equal
+	// values of players (and so equal number of raid times) have equal solutions
+	std::vector<single_player_value_lookup_table> values;
+	std::vector<raid_stream> streams(headers.size());
+	std::vector<raid_stream*> raids;
+	for (size_t i = 0; i < headers.size(); ++i)
+	{
+		values.push_back(build_value_lookup_table(headers[i]));
+		const auto equal = std::find_if(values.begin(), values.begin() + i, [&] (const single_player_value_lookup_table& v)
+			{
+				return v.best == values[i].best && v.acceptable == values[i].acceptable;
+			});
+		if (equal != values.begin() + i)
+		{
+			raids.push_back(raids[equal - values.begin()]);
+			continue;
+		}
+		streams[i].raid_times = headers[i].number_of_raid_times;
+		streams[i].generator.reset(new best_first_generator(headers[i], players));
+		raids.push_back(&streams[i]);
+	}
+	joint_search(raids, shared_hours, max_solutions).solve(results);
+	unsigned long long scored = 0;
+	for (const auto& stream : streams)
+	{
+		if (stream.generator)
+		{
+			scored += stream.generator->nodes_bounded();
+		}
+	}
+	return scored;
+}
+
+/*****************************************************************************/
+// Weekly calendar
+
+bool is_week_enumerated_before(const week_bitmap& first, const week_bitmap& second)
+{
+	for (unsigned int slot = 0; slot < hours_in_week; ++slot)
+	{
+		if (first.test(slot) != second.test(slot))
+		{
+			return first.test(slot);
+		}
+	}
+	return false;
+}
+
+bool is_week_presented_before(const week_solution& first, const week_solution& second)
+{
+	if (first.value != second.value)
+	{
+		return first.value > second.value;
+	}
+	return is_week_enumerated_before(first.slots, second.slots);
+}
+
+week_solver::week_solver(const config_header& header, const roster& p) :
+	raid_times(header.number_of_raid_times),
+	players(p),
+	values(build_value_lookup_table(header)),
+	tables(values, raid_times)
+{
+	if (!players.weekly())
+	{
+		throw std::runtime_error("Weekly calendar needs roster with weekday qualified lists");
+	}
+	build_classes();
+}
+
+void week_solver::solve(size_t max_solutions, std::vector<week_solution>& results)
+{
+	results.clear();
+	frontier = decltype(frontier)();
+	push(week_bitmap(), 0, 0, std::numeric_limits<long long>::max());
+	week_solution solution;
+	while (results.size() < max_solutions && next(solution))
+	{
+		results.push_back(solution);
+	}
+}
+
+void week_solver::build_classes()
+{
+	// Preference of each player for each slot: 0 none, 1 best, 2 acceptable
+	std::map<std::vector<unsigned char>, size_t> class_of_profile;
+	for (unsigned int slot = 0; slot < hours_in_week; ++slot)
+	{
+		std::vector<unsigned char> profile(players.size(), 0);
+		for (size_t i = 0; i < players.size(); ++i)
+		{
+			if (players.best_week(i).test(slot))
+			{
+				profile[i] = 1;
+			}
+			else if (players.acceptable_week(i).test(slot))
+			{
+				profile[i] = 2;
+			}
+		}
+		auto found = class_of_profile.find(profile);
+		if (found == class_of_profile.end())
+		{
+			found = class_of_profile.insert(std::make_pair(profile, classes.size())).first;
+			slot_class new_class;
+			for (unsigned int i = 0; i < players.size(); ++i)
+			{
+				if (profile[i] == 1)
+				{
+					new_class.best_players.push_back(i);
+					new_class.single_slot_value += values.best[1];
+				}
+				else if (profile[i] == 2)
+				{
+					new_class.acceptable_players.push_back(i);
+					new_class.single_slot_value += values.acceptable[1];
+				}
+			}
+			classes.push_back(new_class);
+		}
+		classes[found->second].slots.push_back(slot);
+		classes[found->second].mask.set(slot);
+	}
+
+	// Promising classes are decided first, so bounds get tight early
+	std::stable_sort(classes.begin(), classes.end(), [] (const slot_class& first, const slot_class& second)
+	{
+		return first.single_slot_value > second.single_slot_value;
+	});
+
+	undecided_masks.assign(classes.size() + 1, week_bitmap());
+	undecided_slots.assign(classes.size() + 1, std::vector<unsigned int>());
+	for (size_t c = classes.size(); c-- > 0;)
+	{
+		undecided_masks[c] = undecided_masks[c + 1] | classes[c].mask;
+		for (unsigned int slot = 0; slot < hours_in_week; ++slot)
+		{
+			if (undecided_masks[c].test(slot))
+			{
+				undecided_slots[c].push_back(slot);
+			}
+		}
+	}
+	DEBUG_LOG << "weekly calendar has " << classes.size() << " classes of equivalent slots\n";
+}
+
+
+bool week_solver::next(week_solution& solution)
+{
+	while (!frontier.empty())
+	{
+		const node n = frontier.top();
+		frontier.pop();
+		if (n.decided_classes == classes.size())
+		{
+			solution.value = n.bound;
+			solution.slots = n.included;
+			solution.equivalent = 1;
+			for (const auto& c : classes)
+			{
+				solution.equivalent *= number_of_combinations(c.slots.size(), (n.included & c.mask).count());
+			}
+			return true;
+		}
+		const auto& slots = classes[n.decided_classes].slots;
+		const unsigned int most = std::min<unsigned int>(raid_times - n.included_times, slots.size());
+		week_bitmap included = n.included;
+		for (unsigned int count = 0; ; ++count)
+		{
+			push(included, n.decided_classes + 1, n.included_times + count, n.bound);
+			if (count == most)
+			{
+				break;
+			}
+			included.set(slots[count]);
+		}
+	}
+	return false;
+}
+
+
+/* Upper bound of gain of remaining_times slots from undecided classes, when
+ * gains are diminishing. Gain of j-th slot taken from a class is exact for
+ * its players alone and decreases with j, and gain of a player from
+ * several classes is at most sum of his gains from each of them, so the
+ * best remaining_times gains of slots of all classes are a bound. It
+ * counts players wanting several classes several times, while a player
+ * can't gain more than if undecided slots were chosen for him alone (his
+ * cap). Any part of a player may be counted by his cap and the rest by his
+ * gains, so parts of players gaining more than their caps from the best
+ * slots are moved to caps in a few steps (Lagrangian relaxation of the
+ * caps). Parts are kept between nodes, nearby nodes need similar parts.
+ */
+long long week_solver::gains_bound(unsigned int decided_classes, unsigned int remaining_times)
+{
+	static const int whole = 1024;
+	static const unsigned int steps = 4;
+	const week_bitmap& available = undecided_masks[decided_classes];
+	const unsigned int available_slots = undecided_slots[decided_classes].size();
+	for (size_t i = 0; i < players.size(); ++i)
+	{
+		const unsigned int available_best = (players.best_week(i) & available).count();
+		const unsigned int available_acceptable = (players.acceptable_week(i) & available).count();
+		gain_caps[i] = available_best + available_acceptable == 0 ? 0 :
+				max_player_value(values, table_index[i] / tables.stride, table_index[i] % tables.stride, available_best, available_acceptable,
+						available_slots - available_best - available_acceptable, remaining_times) - tables.player_values[table_index[i]];
+	}
+	long long bound = std::numeric_limits<long long>::max();
+	for (unsigned int step = 0; step < steps; ++step)
+	{
+		long long step_bound = 0;
+		for (size_t i = 0; i < players.size(); ++i)
+		{
+			step_bound += capped_parts[i] * gain_caps[i];
+		}
+		class_gains.clear();
+		for (size_t c = decided_classes; c < classes.size(); ++c)
+		{
+			const size_t first = class_gains.size();
+			class_gains.resize(first + std::min<size_t>(classes[c].slots.size(), remaining_times), std::make_pair(0, c));
+			for (const auto i : classes[c].best_players)
+			{
+				const int part = whole - capped_parts[i];
+				for (size_t j = first, index = table_index[i]; part != 0 && j < class_gains.size(); ++j, index += tables.stride)
+				{
+					class_gains[j].first += part * tables.best_gains[index];
+				}
+			}
+			for (const auto i : classes[c].acceptable_players)
+			{
+				const int part = whole - capped_parts[i];
+				for (size_t j = first, index = table_index[i]; part != 0 && j < class_gains.size(); ++j, ++index)
+				{
+					class_gains[j].first += part * tables.acceptable_gains[index];
+				}
+			}
+		}
+		std::nth_element(class_gains.begin(), class_gains.begin() + remaining_times - 1, class_gains.end(),
+				std::greater<std::pair<long long, unsigned int> >());
+		taken_slots.assign(classes.size(), 0);
+		for (unsigned int j = 0; j < remaining_times; ++j)
+		{
+			step_bound += class_gains[j].first;
+			++taken_slots[class_gains[j].second];
+		}
+		bound = std::min(bound, (step_bound + whole - 1) / whole);
+		if (step + 1 == steps)
+		{
+			break;
+		}
+
+		// Gains of players from the best slots, slots of a class are
+		// counted as the first ones, which have the same gains in total
+		player_gains.assign(players.size(), 0);
+		for (size_t c = decided_classes; c < classes.size(); ++c)
+		{
+			for (const auto i : classes[c].best_players)
+			{
+				for (unsigned int j = 0, index = table_index[i]; j < taken_slots[c]; ++j, index += tables.stride)
+				{
+					player_gains[i] += tables.best_gains[index];
+				}
+			}
+			for (const auto i : classes[c].acceptable_players)
+			{
+				for (unsigned int j = 0, index = table_index[i]; j < taken_slots[c]; ++j, ++index)
+				{
+					player_gains[i] += tables.acceptable_gains[index];
+				}
+			}
+		}
+		const long long step_size = whole / (2 << step);
+		for (size_t i = 0; i < players.size(); ++i)
+		{
+			const long long scale = std::max(gain_caps[i], player_gains[i]);
+			if (scale != 0)
+			{
+				const long long part = capped_parts[i] + step_size * (player_gains[i] - gain_caps[i]) / scale;
+				capped_parts[i] = std::max<long long>(0, std::min<long long>(whole, part));
+			}
+		}
+	}
+	return bound;
+}
+
+
+/* Classes are decided in order, a node chooses how many slots to take from
+ * the next class. Only the first slots of a class are taken, so of
+ * solutions which differ only by slots taken from the same classes just
+ * the first one in enumeration order is searched. Partial solution which
+ * can be completed in single way is completed right away, so only complete
+ * solutions have all classes decided and their bound is value.
+ */
+void week_solver::push(week_bitmap included, unsigned int decided_classes, unsigned int included_times, long long parent_bound)
+{
+	++generated;
+	const unsigned int remaining_times = raid_times - included_times;
+	const auto& open = undecided_slots[decided_classes];
+	if (open.size() < remaining_times)
+	{
+		return;
+	}
+
+	node n;
+	n.decided_classes = decided_classes;
+	n.included_times = included_times;
+	if (remaining_times == 0)
+	{
+		n.decided_classes = classes.size();
+	}
+	else if (open.size() == remaining_times)
+	{
+		included |= undecided_masks[decided_classes];
+		n.included_times = raid_times;
+		n.decided_classes = classes.size();
+	}
+	n.included = included;
+	n.first_completion = included;
+	// Undecided slots can be taken in any number from each class, the
+	// earliest ones in the week give the first completion
+	for (unsigned int i = 0; i < remaining_times && n.decided_classes < classes.size(); ++i)
+	{
+		n.first_completion.set(open[i]);
+	}
+
+	++bounded;
+	long long value = 0;
+	table_index.resize(players.size());
+	gain_caps.resize(players.size());
+	capped_parts.resize(players.size());
+	for (size_t i = 0; i < players.size(); ++i)
+	{
+		table_index[i] = (players.best_week(i) & included).count() * tables.stride + (players.acceptable_week(i) & included).count();
+		value += tables.player_values[table_index[i]];
+	}
+
+	if (n.decided_classes == classes.size())
+	{
+		n.bound = value;
+	}
+	else if (tables.diminishing_gains)
+	{
+		// Bound of the parent holds for its children too
+		n.bound = std::min(parent_bound, value + gains_bound(decided_classes, remaining_times));
+	}
+	else
+	{
+		n.bound = 0;
+		const week_bitmap& available = undecided_masks[decided_classes];
+		for (size_t i = 0; i < players.size(); ++i)
+		{
+			const unsigned int available_best = (players.best_week(i) & available).count();
+			const unsigned int available_acceptable = (players.acceptable_week(i) & available).count();
+			n.bound += max_player_value(values, table_index[i] / tables.stride, table_index[i] % tables.stride, available_best, available_acceptable,
+					open.size() - available_best - available_acceptable, remaining_times);
+		}
+	}
+	frontier.push(n);
+}
+
+
+/*****************************************************************************/
+// Leave-one-out impact
+
+scored_solution leave_one_out_impact(const config_header& header, const roster& players, std::vector<player_impact>& impacts)
+{
+	const unsigned int raid_times = header.number_of_raid_times;
+	const auto values = build_value_lookup_table(header);
+	const std::vector<preference_profile> profiles = distinct_preferences(players);
+	const player_gain_tables tables(values, raid_times);
+
+	// Solutions are scored in enumeration order, so among solutions of the same
+	// value the first one is kept, as in the order of presentation
+	const long long no_value = std::numeric_limits<long long>::min();
+	scored_solution optimum(no_value, time_bitmap());
+	std::vector<scored_solution> optimum_without(profiles.size(), optimum);
+	std::vector<long long> contributions(profiles.size());
+	auto it = all_solutions_iterator::begin(raid_times);
+	const auto end = all_solutions_iterator::end(raid_times);
+	for (; it != end; ++it)
+	{
+		const unsigned int hours = (*it).get_data();
+		long long total = 0;
+		for (size_t p = 0; p < profiles.size(); ++p)
+		{
+			contributions[p] = tables.player_values[tables.index(number_of_set_bits(profiles[p].best & hours),
+				number_of_set_bits(profiles[p].acceptable & hours))];
+			total += profiles[p].count * contributions[p];
+		}
+		if (total > optimum.first)
+		{
+			optimum = scored_solution(total, *it);
+		}
+		for (size_t p = 0; p < profiles.size(); ++p)
+		{
+			if (total - contributions[p] > optimum_without[p].first)
+			{
+				optimum_without[p] = scored_solution(total - contributions[p], *it);
+			}
+		}
+	}
+
+	impacts.clear();
+	impacts.reserve(players.size());
+	const unsigned int optimum_hours = optimum.second.get_data();
+	for (size_t i = 0; i < players.size(); ++i)
+	{
+		const unsigned int best = players.best_masks()[i];
+		const unsigned int acceptable = players.acceptable_masks()[i];
+		// Profiles are sorted by acceptable hours, then by best ones
+		const auto profile = std::lower_bound(profiles.begin(), profiles.end(), std::make_pair(acceptable, best),
+				[] (const preference_profile& first, const std::pair<unsigned int, unsigned int>& second)
+				{
+					return std::make_pair(first.acceptable, first.best) < second;
+				});
+		player_impact impact;
+		impact.optimum_without = optimum_without[profile - profiles.begin()];
+		impact.old_optimum_value = optimum.first - tables.player_values[tables.index(number_of_set_bits(best & optimum_hours),
+			number_of_set_bits(acceptable & optimum_hours))];
+		impact.optimum_changed = impact.old_optimum_value < impact.optimum_without.first;
+		impacts.push_back(impact);
+	}
+	return optimum;
+}
+
+/*****************************************************************************/
+// Solver context
+
+void solver_context::load(const std::string& input)
+{
+	clear();
+	std::istringstream stream(input);
+	while (std::getline(stream, current_line).good() || !current_line.empty())
+	{
+		if (current_line_number == 0)
+		{
+			remove_bom(current_line);
+		}
+		++current_line_number;
+		load_line(current_line);
+		current_line.clear();
+	}
+	if (!header_parser.parsed())
+	{
+		throw std::runtime_error("Input has no complete header");
+	}
+}
+
+void solver_context::load_line(const std::string& line)
+{
+	if (is_comment(line))
+	{
+		return;
+	}
+	if (!header_parser.parsed())
+	{
+		header_parser.parse(line);
+		if (header_parser.parsed())
+		{
+			values = build_value_lookup_table(header_parser);
+		}
+		return;
+	}
+	if (members.empty() && config_header_parser::is_header_line(line))
+	{
+		throw parse_error(0, "Only single raid is supported by solver context");
+	}
+	player_parser p(line, header_parser);
+	parse_warnings.insert(parse_warnings.end(), p.warnings.begin(), p.warnings.end());
+	members.add(p);
+}
+
+void solver_context::clear()
+{
+	header_parser = config_header_parser();
+	members.clear();
+	parse_warnings.clear();
+	values = single_player_value_lookup_table();
+	current_line_number = 0;
+	current_line.clear();
+	results.clear();
+	week_results.clear();
+}
+
+const config_header& solver_context::header() const
+{
+	return header_parser;
+}
+
+const roster& solver_context::players() const
+{
+	return members;
+}
+
+const std::vector<std::string>& solver_context::warnings() const
+{
+	return parse_warnings;
+}
+
+unsigned int solver_context::line_number() const
+{
+	return current_line_number;
+}
+
+const std::string& solver_context::line() const
+{
+	return current_line;
+}
+
+const std::vector<scored_solution>& solver_context::solve(size_t max_solutions)
+{
+	if (!header_parser.parsed())
+	{
+		throw std::runtime_error("No roster loaded");
+	}
+	if (members.weekly())
+	{
+		throw std::runtime_error("Roster has weekday qualified lists, it is solved by solve_week");
+	}
+	top_solutions top(results, max_solutions);
+	for (iterator.reset(header_parser.number_of_raid_times); (*iterator).get_data(); ++iterator)
+	{
+		top.add(solution_value(*iterator, members, values), *iterator);
+	}
+	top.finish();
+	return results;
+}
+
+const std::vector<scored_solution>& solver_context::solutions() const
+{
+	return results;
+}
+
+player_score solver_context::score(const time_bitmap& solution, size_t player_index) const
+{
+	if (player_index >= members.size())
+	{
+		throw std::out_of_range("No player " + std::to_string(player_index) + " in roster");
+	}
+	return player_score(number_of_set_bits((members.best_times(player_index) & solution).get_data()),
+			number_of_set_bits((members.acceptable_times(player_index) & solution).get_data()), values);
+}
+
+bool solver_context::weekly() const
+{
+	return members.weekly();
+}
+
+const std::vector<week_solution>& solver_context::solve_week(size_t max_solutions)
+{
+	if (!header_parser.parsed())
+	{
+		throw std::runtime_error("No roster loaded");
+	}
+	if (!members.weekly())
+	{
+		throw std::runtime_error("Roster has no weekday qualified lists, it is solved by solve");
+	}
+	week_solver(header_parser, members).solve(max_solutions, week_results);
+	return week_results;
+}
+
+const std::vector<week_solution>& solver_context::week_solutions() const
+{
+	return week_results;
+}
+
+player_score solver_context::score_week(const week_bitmap& solution, size_t player_index) const
+{
+	if (player_index >= members.size() || !members.weekly())
+	{
+		throw std::out_of_range("No player " + std::to_string(player_index) + " with week calendar in roster");
+	}
+	return player_score((members.best_week(player_index) & solution).count(),
+			(members.acceptable_week(player_index) & solution).count(), values);
+}
@@ -0,0 +1,1120 @@
+#ifndef RAID_SOLVER_HPP
+#define RAID_SOLVER_HPP
+
+#include <algorithm>
+#include <bitset>
+#include <limits>
+#include <locale>
+#include <ostream>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*****************************************************************************/
+// UTF related stuff
+
+size_t console_width(const std::string& line);
+std::string spacer(const std::string& line, size_t position);
+
+/*****************************************************************************/
+// Parsing helpers
+
+// no string_literals in C++11
+//using namespace std::string_literals;
+
+// Parsers skip whitespace of given locale, classic one unless the caller
+// passes other, e.g. locale of the user for input typed by him.
+size_t next_not_white_position(const std::string& line, size_t position, const std::locale& locale = std::locale::classic());
+size_t previous_not_white_position(const std::string& line, size_t position, const std::locale& locale = std::locale::classic());
+bool is_comment(const std::string& line, const std::locale& locale = std::locale::classic());
+void remove_bom(std::string& line);
+
+class parse_error : public std::runtime_error
+{
+public:
+	parse_error(const size_t position, const std::string& what) :
+		runtime_error(what),
+		_position(position)
+	{
+	}
+	size_t get_position() const
+	{
+		return _position;
+	}
+private:
+	const size_t _position;
+};
+
+int parse_int(const std::string& line, size_t& position, const std::string& name);
+
+    template <typename int_type_T, typename converter_T>
+void parse_list_of_integers(const std::string& line, size_t& position, std::vector<int_type_T>& integers, const std::string& name, const size_t end_position, converter_T converter, const std::locale& locale, const char* separators = ",)")
+{
+		while (position < end_position)
+		{
+			const auto next_coma_or_closing_brace_position = line.find_first_of(separators, position);
+			int value = parse_int(line, position, name);
+			position = next_not_white_position(line, position, locale);
+			if (position != next_coma_or_closing_brace_position)
+			{
+				throw parse_error(position, "Garbage found after " + name);
+			}
+			int_type_T converted = converter(value);
+			integers.push_back(converted);
+			if (position < end_position)
+			{
+				++position;
+			}
+		}
+
+		if (position != end_position)
+		{
+			throw parse_error(position, "Garbage found after last " + name);
+		}
+};
+
+// Do nothing converter for parse_list_of_integers
+int void_converter(int value);
+
+unsigned int parse_guild_activities_reset_time(const std::string& line, size_t& position, const std::locale& locale);
+
+/* Whole non negative number which fits unsigned int, e.g. value of command
+ * line option, name is used in message of runtime_error thrown otherwise.
+ */
+unsigned int parse_unsigned(const std::string& name, const std::string& value);
+
+/*****************************************************************************/
+
+class time_bitmap
+{
+public:
+	time_bitmap()
+	{
+	}
+
+	explicit time_bitmap(unsigned int d) :
+		data(d)
+	{
+	}
+
+	unsigned int get_data() const
+	{
+		return data;
+	}
+
+	bool is_set(unsigned int hour) const
+	{
+		return data & (1u << hour);
+	}
+
+	void set(unsigned int hour)
+	{
+		data |= 1u << hour;
+	}
+
+	void unset(unsigned int hour)
+	{
+		data &= ~(1u << hour);
+	}
+
+	void out(std::ostream& stream) const
+	{
+		for (unsigned int i = 0; i < 32; ++i)
+		{
+			if (is_set(i))
+			{
+				stream << i << " ";
+			}
+		}
+	}
+
+	time_bitmap operator&(const time_bitmap& other) const
+	{
+		time_bitmap retval;
+		retval.data = data & other.data;
+		return retval;
+	}
+
+	time_bitmap& operator^=(const time_bitmap& other)
+	{
+		data ^= other.data;
+		return *this;
+	}
+private:
+	unsigned int data = 0;
+};
+
+/* Hours of the whole week, slot 0 is Monday 0:00 in guild reset timezone */
+const unsigned int hours_in_week = 7 * 24;
+typedef std::bitset<hours_in_week> week_bitmap;
+
+extern const char* const day_names[7];
+
+std::string week_slot_label(unsigned int slot);
+
+/* Week with given hours of day on every day */
+week_bitmap every_day_of_week(const time_bitmap& hours);
+
+struct config_header
+{
+
+	unsigned int number_of_raid_times = 0;
+	unsigned int hour_of_master_activities_reset = 0;
+	std::vector<int> best_weights;
+	std::vector<int> acceptable_weights;
+
+	void out(std::ostream& stream) const
+	{
+		stream << "best\n";
+		for (const auto& i : best_weights)
+		{
+			stream << i << "\n";
+		}
+		stream << "acceptable\n";
+		for (const auto& i : acceptable_weights)
+		{
+			stream << i << "\n";
+		}
+	}
+
+};
+
+struct config_header_parser : config_header
+{
+	explicit config_header_parser(const std::locale& l = std::locale::classic()) : locale(l)
+	{
+	}
+
+	static const std::string raid_times_label;
+	static const std::string guild_reset_label;
+	static const std::string best_weights_label;
+	static const std::string acceptable_weights_label;
+
+	bool number_of_raid_times_parsed = false;
+	bool hour_of_master_activities_reset_parsed = false;
+	bool best_weights_parsed = false;
+	bool acceptable_weights_parsed = false;
+	std::locale locale;
+
+	bool parsed() const
+	{
+		return number_of_raid_times_parsed && hour_of_master_activities_reset_parsed && best_weights_parsed && acceptable_weights_parsed;
+	}
+
+	static bool is_header_line(const std::string& line, const std::locale& locale = std::locale::classic())
+	{
+		const size_t position = next_not_white_position(line, 0, locale);
+		for (const auto label : {&raid_times_label, &guild_reset_label, &best_weights_label, &acceptable_weights_label})
+		{
+			if (line.find(*label, position) == position)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool parse_label(const std::string& line, size_t& position, const std::string& label)
+	{
+		if (line.find(label, position) == position)
+		{
+			position = next_not_white_position(line, label.size(), locale);
+			if (position == std::string::npos)
+			{
+				throw parse_error(raid_times_label.size(), "Expected something after label \"" + label + "\", but found only whitespace");
+			}
+			return true;
+		}
+		return false;
+	}
+
+	void check_for_end_of_line_garbage(const std::string& line, size_t& position)
+	{
+		position = next_not_white_position(line, position, locale);
+		if (position != std::string::npos)
+		{
+			throw parse_error(position, "Garbage found at the end of line");
+		}
+	}
+
+	void parse(const std::string& line)
+	{
+		size_t position = next_not_white_position(line, 0, locale);
+
+		if (parse_label(line, position, raid_times_label))
+		{
+			parse_number_of_best_raid_times(line, position);
+			number_of_raid_times_parsed = true;
+		}
+		else if (parse_label(line, position, guild_reset_label))
+		{
+			parse_hour_of_master_activities_reset(line, position);
+			hour_of_master_activities_reset_parsed = true;
+		}
+		else if (parse_label(line, position, best_weights_label))
+		{
+			parse_list_of_integers(line, position, best_weights, "best weights", std::string::npos, void_converter, locale);
+			best_weights_parsed = true;
+		}
+		else if (parse_label(line, position, acceptable_weights_label))
+		{
+			parse_list_of_integers(line, position, acceptable_weights, "acceptable weights", std::string::npos, void_converter, locale);
+			acceptable_weights_parsed = true;
+		}
+		else
+		{
+			throw parse_error(0, "Unrecognized header line, we expect one of:\n" +
+					raid_times_label + "\n" +
+					guild_reset_label + "\n" +
+					best_weights_label + "\n" +
+					acceptable_weights_label + "\n"
+					);
+		}
+	}
+
+	void parse_number_of_best_raid_times(const std::string& line, size_t& position)
+	{
+		const int number = parse_int(line, position, "number of raid times to seek");
+		if (number < 1 || number > 23)
+		{
+			throw parse_error(position, "Invalid number of raid times to seek, got " + std::to_string(number) +
+					" which is not reasonable --- should be at least 1 and at most 23");
+		}
+		check_for_end_of_line_garbage(line, position);
+		number_of_raid_times = number;
+	}
+
+	void parse_hour_of_master_activities_reset(const std::string& line, size_t& position)
+	{
+		hour_of_master_activities_reset = parse_guild_activities_reset_time(line, position, locale);
+		check_for_end_of_line_garbage(line, position);
+	}
+};
+
+struct player
+{
+	// Name is the beginning of parsed line, roster copies it from there
+	size_t name_length = 0;
+	bool guild_activities_reset_reset_hour_was_set = false;
+	unsigned int hour_of_guild_activities_reset_in_player_time;
+	time_bitmap best_times_in_master_time;
+	time_bitmap acceptable_times_in_master_time;
+	// Set when any list is qualified with weekdays, then times of the whole week
+	// shall be used. Lists without weekdays apply to every day of the week.
+	// Week times are set only then.
+	bool weekly = false;
+	week_bitmap best_times_in_master_week;
+	week_bitmap acceptable_times_in_master_week;
+
+	static void out_week_slots(std::ostream& stream, const week_bitmap& slots)
+	{
+		bool first_item_printed = false;
+		for (unsigned int i = 0; i < hours_in_week; ++i)
+		{
+			if (slots.test(i))
+			{
+				stream << (first_item_printed ? ", " : "") << week_slot_label(i);
+				first_item_printed = true;
+			}
+		}
+	}
+};
+
+struct player_parser : player
+{
+	const std::string& line;
+	const config_header& config;
+	const std::locale locale;
+	// Messages about problems which were fixed, for the caller to present
+	std::vector<std::string> warnings;
+
+	player_parser(const std::string& l, const config_header& header, const std::locale& loc = std::locale::classic());
+
+	void out(std::ostream& stream) const
+	{
+		if (weekly)
+		{
+			out_week(stream);
+			return;
+		}
+		stream.write(line.data(), name_length);
+		stream << ", best(";
+		bool first_item_printed = false;
+		for (unsigned int i = 0; i < 24; ++i)
+		{
+			if (best_times_in_master_time.is_set(i))
+			{
+				if (first_item_printed)
+				{
+					stream << ", ";
+				}
+				else
+				{
+					first_item_printed = true;
+				}
+				stream << i ;
+			}
+		}
+
+		stream << "), acceptable(" ;
+		first_item_printed = false;
+		for (unsigned int i = 0; i < 24; ++i)
+		{
+			if (acceptable_times_in_master_time.is_set(i))
+			{
+				if (first_item_printed)
+				{
+					stream << ", ";
+				}
+				else
+				{
+					first_item_printed = true;
+				}
+				stream << i ;
+			}
+		}
+		stream << ")\n";
+	}
+
+	void out_week(std::ostream& stream) const
+	{
+		stream.write(line.data(), name_length);
+		stream << ", best(";
+		out_week_slots(stream, best_times_in_master_week);
+		stream << "), acceptable(";
+		out_week_slots(stream, acceptable_times_in_master_week);
+		stream << ")\n";
+	}
+
+	size_t parse_single_command(const size_t pre_command_coma_position);
+	void parse_list_of_times(size_t& position, time_bitmap& times, week_bitmap& week_times, const std::string& list_name, const size_t end_position);
+
+	/* List of groups separated with semicolon, each group is day or range of
+	 * days, colon and list of hours, e.g. "Sat:14,15;Mon-Fri:19,20". Hours are
+	 * in player local time and conversion to guild time can move them to the
+	 * previous or next day.
+	 */
+	void parse_list_of_week_times(size_t& position, week_bitmap& times, const std::string& list_name, const size_t end_position);
+
+	/* Day ("Sat") or range of days ("Mon-Fri", "Sat-Mon"), returns bitmap of days */
+	unsigned int parse_days(size_t position, const size_t end_position);
+	unsigned int parse_day(const size_t position, const size_t end_position);
+};
+
+/*****************************************************************************/
+// Roster
+//
+// Scoring reads nothing but masks of best and acceptable hours, so they are kept
+// in two packed arrays and scoring streams only 8 bytes per player through
+// cache. Everything else is cold: names are copied from parsed lines one after
+// another into single arena and found by offset. Week calendars are kept aside
+// and only when any player has weekday qualified list.
+
+class roster
+{
+public:
+	void add(const player_parser& p);
+	void clear();
+	void reserve(size_t players);
+
+	size_t size() const
+	{
+		return best.size();
+	}
+
+	bool empty() const
+	{
+		return best.empty();
+	}
+
+	/* Name is terminated with zero */
+	const char* name(size_t index) const
+	{
+		return names.data() + name_offsets[index];
+	}
+
+	time_bitmap best_times(size_t index) const
+	{
+		return time_bitmap(best[index]);
+	}
+
+	time_bitmap acceptable_times(size_t index) const
+	{
+		return time_bitmap(acceptable[index]);
+	}
+
+	const unsigned int* best_masks() const
+	{
+		return best.data();
+	}
+
+	const unsigned int* acceptable_masks() const
+	{
+		return acceptable.data();
+	}
+
+	/* True when any player has weekday qualified list */
+	bool weekly() const
+	{
+		return any_weekly;
+	}
+
+	/* Only when weekly() */
+	const week_bitmap& best_week(size_t index) const
+	{
+		return weeks[index].best;
+	}
+
+	const week_bitmap& acceptable_week(size_t index) const
+	{
+		return weeks[index].acceptable;
+	}
+
+private:
+	struct week_calendar
+	{
+		week_bitmap best;
+		week_bitmap acceptable;
+	};
+
+	std::vector<unsigned int> best;
+	std::vector<unsigned int> acceptable;
+	std::vector<char> names;
+	std::vector<size_t> name_offsets;
+	// Empty until the first player with weekday qualified list, players
+	// before him get their daily times on every day then
+	std::vector<week_calendar> weeks;
+	bool any_weekly = false;
+};
+
+struct all_solutions_iterator
+{
+	std::vector<unsigned int> included;
+	time_bitmap current;
+
+	static all_solutions_iterator begin(unsigned int times)
+	{
+		return all_solutions_iterator(times);
+	}
+
+	static all_solutions_iterator end(unsigned int times)
+	{
+		auto retval = all_solutions_iterator();
+		retval.included.resize(times);
+		return retval;
+	}
+
+	all_solutions_iterator()
+	{
+	}
+
+	all_solutions_iterator(unsigned int raid_times)
+	{
+		reset(raid_times);
+	}
+
+	/* Back to the first solution, buffer of included hours is reused */
+	void reset(unsigned int raid_times)
+	{
+		included.clear();
+		current = time_bitmap();
+		for (unsigned int i = raid_times - 1; i < 24; --i)
+		{
+			included.push_back(i);
+			current.set(i);
+		}
+	}
+
+	all_solutions_iterator& operator++()
+	{
+		if (!current.get_data())
+		{
+			return *this;
+		}
+
+		/* This is how it works:
+		 * Times Bitmap i j
+		 * 0 1 2 11100  0 -
+		 * 0 1 3 11010  0 -
+		 * 0 1 4 11001  0 -
+		 * 0 1 5        1 -
+		 * 0 2 5        1 0
+		 * 0 2 3 10110  0 -
+		 * 0 2 4 10101  0 -
+		 * 0 2 5        1 -
+		 * 0 3 5        1 0
+		 * 0 3 4 10011  0 -
+		 * 0 3 5        1 -
+		 * 0 4 5        2 -
+		 * 1 4 5        2 1
+		 * 1 2 5        2 0
+		 * 1 2 3 01110  0 -
+		 * 1 2 4 01101  0 -
+		 * 1 2 5        1 -
+		 * 1 3 5        1 0
+		 * 1 3 4 01011  0 -
+		 * 1 3 5        1 -
+		 * 1 4 5        2 -
+		 * 2 4 5        2 1
+		 * 2 3 5        2 0
+		 * 2 3 4 00111  0 -
+		 * 2 3 5        1 -
+		 * 2 4 5        2 -
+		 * 3 4 5        - - (after i loop)
+		 * 3 4 5 00000
+		 */
+		for (unsigned int i = 0; i < included.size(); ++i)
+		{
+			current.unset(included[i]);
+			++included[i];
+			if (included[i] < (24 - i))
+			{
+				current.set(included[i]);
+				for (unsigned int j = (i - 1); j < 24; --j)
+				{
+					included[j] = included[j + 1] + 1;
+					current.set(included[j]);
+				}
+				return *this;
+			}
+		}
+		current = time_bitmap();
+		return *this;
+	}
+
+	const time_bitmap& operator*() const
+	{
+		return current;
+	}
+
+	bool operator==(const all_solutions_iterator& other) const
+	{
+		if (this == &other)
+		{
+			return true;
+		}
+		if (included.size() != other.included.size())
+		{
+			return false;
+		}
+		return current.get_data() == other.current.get_data();
+	}
+
+	bool operator!=(const all_solutions_iterator& other) const
+	{
+		return ! (*this == other);
+	}
+
+};
+
+/* Taken from:
+ * https://stackoverflow.com/questions/109023/how-to-count-the-number-of-set-bits-in-a-32-bit-integer
+ */
+inline unsigned int number_of_set_bits(unsigned int i)
+{
+#if USE_POP_COUNT
+	return __builtin_popcount(i);
+#else
+	i = i - ((i >> 1) & 0x55555555u);
+	i = (i & 0x33333333u) + ((i >> 2) & 0x33333333u);
+	return (((i + (i >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24;
+#endif
+}
+
+/* Index of the lowest set bit, i must not be zero */
+inline unsigned int lowest_set_bit(unsigned int i)
+{
+#if USE_POP_COUNT
+	return __builtin_ctz(i);
+#else
+	return number_of_set_bits((i & (~i + 1)) - 1);
+#endif
+}
+
+struct single_player_value_lookup_table
+{
+	std::vector<unsigned int> best;
+	std::vector<unsigned int> acceptable;
+};
+
+single_player_value_lookup_table build_value_lookup_table(const config_header& header);
+
+long long solution_value(const time_bitmap& solution, const roster& players, const single_player_value_lookup_table& values);
+
+/* Highest value single player can get when solution is completed with
+ * remaining_times hours picked from available ones, given that
+ * chosen_best/chosen_acceptable hours of his lists are already included.
+ */
+long long max_player_value(const single_player_value_lookup_table& values,
+		unsigned int chosen_best, unsigned int chosen_acceptable,
+		unsigned int available_best, unsigned int available_acceptable, unsigned int available_other,
+		unsigned int remaining_times);
+
+/* Upper bound of value of any solution which uses only hours from available */
+long long solution_value_upper_bound(const time_bitmap& available, unsigned int raid_times, const roster& players, const single_player_value_lookup_table& values);
+
+unsigned long long number_of_combinations(unsigned int n, unsigned int k);
+
+bool is_enumerated_before(const time_bitmap& first, const time_bitmap& second);
+
+typedef std::pair<long long, time_bitmap> scored_solution;
+
+bool is_presented_before(const scored_solution& first, const scored_solution& second);
+
+const unsigned int max_solutions_to_present = 2048;
+
+/* How single player contributes to value of a solution */
+struct player_score
+{
+	unsigned int best_times;
+	unsigned int acceptable_times;
+	long long best_value;
+	long long acceptable_value;
+
+	player_score(unsigned int best, unsigned int acceptable, const single_player_value_lookup_table& values) :
+		best_times(best),
+		acceptable_times(acceptable),
+		best_value(values.best[best_times]),
+		acceptable_value(values.acceptable[best_times + acceptable_times] - values.acceptable[best_times])
+	{
+	}
+};
+
+/* Value single player adds to solution with best_times of his best and
+ * acceptable_times of his acceptable hours, exactly as solution_value sums it
+ */
+inline long long single_player_value(const single_player_value_lookup_table& values, unsigned int best_times, unsigned int acceptable_times)
+{
+	return static_cast<long long>(values.best[best_times]) + (values.acceptable[best_times + acceptable_times] - values.acceptable[best_times]);
+}
+
+/* Players with the same preferences, they add the same value to any solution */
+struct preference_profile
+{
+	unsigned int best;
+	unsigned int acceptable;
+	long long count;
+};
+
+std::vector<preference_profile> distinct_preferences(const roster& players);
+
+/* Value of single player and what one more of his best or acceptable times
+ * would add to it, by numbers of his best and acceptable times already chosen.
+ * Searches read them for every player of every node when bounding it.
+ */
+struct player_gain_tables
+{
+	player_gain_tables(const single_player_value_lookup_table& values, unsigned int raid_times);
+
+	unsigned int index(unsigned int best_times, unsigned int acceptable_times) const
+	{
+		return best_times * stride + acceptable_times;
+	}
+
+	const unsigned int stride;
+	std::vector<long long> player_values;
+	// Zero when all raid times are chosen
+	std::vector<long long> best_gains;
+	std::vector<long long> acceptable_gains;
+	// No time adds more to a player than it would with fewer times chosen
+	bool diminishing_gains = true;
+};
+
+/* Keeps best max_solutions of added solutions, which may come in any order,
+ * and sorts them in the order of presentation by finish(). Until then results
+ * are a heap with the solution presented last on top, so a candidate is
+ * compared only with it.
+ */
+class top_solutions
+{
+public:
+	top_solutions(std::vector<scored_solution>& r, size_t max) :
+		results(r),
+		max_solutions(max)
+	{
+		results.clear();
+		results.reserve(max_solutions);
+	}
+
+	void add(long long value, const time_bitmap& solution)
+	{
+		if (results.size() < max_solutions)
+		{
+			results.push_back(scored_solution(value, solution));
+			std::push_heap(results.begin(), results.end(), is_presented_before);
+		}
+		else if (max_solutions != 0 && value >= results.front().first &&
+				is_presented_before(scored_solution(value, solution), results.front()))
+		{
+			std::pop_heap(results.begin(), results.end(), is_presented_before);
+			results.back() = scored_solution(value, solution);
+			std::push_heap(results.begin(), results.end(), is_presented_before);
+		}
+	}
+
+	void finish()
+	{
+		std::sort_heap(results.begin(), results.end(), is_presented_before);
+	}
+
+private:
+	std::vector<scored_solution>& results;
+	const size_t max_solutions;
+};
+
+/*****************************************************************************/
+// Engines
+//
+// Engine finds best max_solutions solutions of single raid in the order of
+// presentation and returns number of (complete or partial) solutions it scored.
+// All of them give exactly the same results as the reference calculation
+// (all_solutions_iterator, solution_value and multimap), ties included, they
+// differ only in speed.
+
+typedef unsigned long long (*engine_function)(const config_header& header, const roster& players, size_t max_solutions, std::vector<scored_solution>& results);
+
+struct solver_engine
+{
+	const char* name;
+	const char* description;
+	engine_function solve;
+};
+
+extern const solver_engine solver_engines[];
+extern const size_t number_of_solver_engines;
+
+/* Returns nullptr for unknown name */
+const solver_engine* find_solver_engine(const std::string& name);
+
+/* Scores every solution given by all_solutions_iterator */
+unsigned long long solve_by_enumeration(const config_header& header, const roster& players, size_t max_solutions, std::vector<scored_solution>& results);
+
+/* Two level enumeration: counts of high block of hours are computed once for
+ * all completions by low block
+ */
+unsigned long long solve_nested(const config_header& header, const roster& players, size_t max_solutions, std::vector<scored_solution>& results);
+
+/* Pulls solutions from best_first_generator */
+unsigned long long solve_best_first(const config_header& header, const roster& players, size_t max_solutions, std::vector<scored_solution>& results);
+
+/* Produces solutions of single raid one by one on demand, in the order of
+ * presentation. Search is best-first over decisions whether hour 0, 1, ... 23
+ * is included: frontier of partial solutions is ordered by upper bound of
+ * their value, ties by the first solution they can be completed to in
+ * enumeration order. When complete solution gets on top, no partial one can be
+ * completed to solution presented before it, so only as much of the space is
+ * searched as is needed for solutions pulled so far.
+ *
+ * When weights give diminishing gains (no hour adds more to a player than it
+ * would with fewer hours chosen), value of a solution is at most value of
+ * chosen hours plus the highest gains of the remaining ones. Otherwise bound is
+ * sum of the highest values players can get separately, which is much looser.
+ */
+class best_first_generator
+{
+public:
+	best_first_generator(const config_header& header, const roster& players);
+
+	/* Next solution, false when all of them were produced */
+	bool next(scored_solution& solution);
+
+	/* Number of partial and complete solutions whose value was bounded */
+	unsigned long long nodes_bounded() const
+	{
+		return bounded;
+	}
+
+	/* When gains are diminishing, value of any solution is at most value of
+	 * no hours plus hour_gain of each of its hours
+	 */
+	bool has_diminishing_gains() const
+	{
+		return tables.diminishing_gains;
+	}
+
+	long long empty_value() const
+	{
+		return empty_solution_value;
+	}
+
+	long long hour_gain(unsigned int hour) const
+	{
+		return empty_solution_gains[hour];
+	}
+
+private:
+	struct node
+	{
+		long long bound;
+		// First solution in enumeration order this one can be completed to
+		time_bitmap first_completion;
+		time_bitmap included;
+		unsigned int next_hour;
+		unsigned int included_times;
+	};
+
+	struct is_popped_after
+	{
+		bool operator()(const node& first, const node& second) const
+		{
+			if (first.bound != second.bound)
+			{
+				return first.bound < second.bound;
+			}
+			return is_enumerated_before(second.first_completion, first.first_completion);
+		}
+	};
+
+	void push(time_bitmap included, unsigned int next_hour, unsigned int included_times);
+
+	const unsigned int raid_times;
+	const single_player_value_lookup_table values;
+	const std::vector<preference_profile> profiles;
+	const player_gain_tables tables;
+	long long empty_solution_value = 0;
+	long long empty_solution_gains[24] = {0};
+	std::priority_queue<node, std::vector<node>, is_popped_after> frontier;
+	unsigned long long bounded = 0;
+};
+
+/*****************************************************************************/
+// Joint optimization of several raids
+//
+// Each raid has own header (number of raid times and weights) and value of
+// joint solution is sum of values of raids. Without restrictions raids are
+// independent, but when raids can't share hours best solution of one raid
+// is often not part of best joint solution. Solutions of each raid are pulled
+// from its best_first_generator only as far as the search gets, combinations
+// are searched from the best ones. Remaining raids are bounded by their best
+// solutions and, when they can't share hours, by the best gains of hours still
+// free, each hour counted for one raid only. Search is pruned when bound can't
+// get combination into presented ones, equal bound too when order of
+// presentation puts the combination after all of them. Until enough
+// combinations are found, the bound is compared with the lowest value of the
+// first ones reached by taking the best solutions of each raid.
+// Raids with equal values of players share one generator and take its
+// solutions in enumeration order only, other arrangements of the same
+// solutions are recorded together with it, so identical raids are not
+// searched once per permutation. Without shared hours blocks of solutions all
+// including some taken hour are skipped at once.
+
+struct joint_solution
+{
+	long long value;
+	// Solution of each raid in order of headers
+	std::vector<scored_solution> raids;
+};
+
+/* Higher value first, ties by enumeration order of the first raid whose
+ * solutions differ
+ */
+bool is_joint_presented_before(const joint_solution& first, const joint_solution& second);
+
+/* Best max_solutions joint solutions in the order of presentation, returns
+ * number of (complete or partial) solutions of single raids scored. Players'
+ * hours are in timezone of the first raid.
+ */
+unsigned long long solve_joint(const std::vector<config_header>& headers, const roster& players, bool shared_hours,
+		size_t max_solutions, std::vector<joint_solution>& results);
+
+/*****************************************************************************/
+// Weekly calendar
+//
+// Naive search over C(168, k) solutions is not feasible, but most slots of the
+// week are not distinguishable: if every player has the same preference for two
+// slots (e.g. Tuesday and Wednesday 19:00 for members who gave Mon-Fri lists,
+// or any two night hours nobody wants), then swapping them does not change the
+// value of a solution. Slots are grouped into classes of such equivalent
+// slots, so identical days collapse into the same classes, and only the first
+// of solutions differing by slots of the same classes is searched.
+//
+// Days can't be solved separately, value of a player depends on number of
+// chosen slots in the whole week, so the week is searched as one problem over
+// classes instead of days: best-first over decisions how many slots are taken
+// from each class, most valuable classes first, so bounds get tight early.
+// Every node has an upper bound of its solutions, frontier is ordered by it,
+// ties by the first solution the node can be completed to, so equal bounds are
+// resolved by order of presentation and search stops as soon as enough
+// solutions are found, nodes which can't come earlier are never expanded.
+
+struct week_solution
+{
+	long long value;
+	week_bitmap slots;
+	// Number of solutions with the same value obtained by choosing other slots
+	// from the same classes
+	double equivalent;
+};
+
+bool is_week_enumerated_before(const week_bitmap& first, const week_bitmap& second);
+
+bool is_week_presented_before(const week_solution& first, const week_solution& second);
+
+class week_solver
+{
+public:
+	/* Players' week calendars are searched, so roster must be weekly() */
+	week_solver(const config_header& header, const roster& players);
+
+	size_t number_of_classes() const
+	{
+		return classes.size();
+	}
+
+	/* Best max_solutions solutions in order of presentation */
+	void solve(size_t max_solutions, std::vector<week_solution>& results);
+
+	/* Number of partial and complete solutions generated so far */
+	unsigned long long nodes_generated() const
+	{
+		return generated;
+	}
+
+	/* Number of generated solutions which could be completed, so they were
+	 * bounded
+	 */
+	unsigned long long nodes_bounded() const
+	{
+		return bounded;
+	}
+
+private:
+	struct slot_class
+	{
+		// In the order of the week
+		std::vector<unsigned int> slots;
+		week_bitmap mask;
+		std::vector<unsigned int> best_players;
+		std::vector<unsigned int> acceptable_players;
+		long long single_slot_value = 0;
+	};
+
+	struct node
+	{
+		long long bound;
+		// First solution in enumeration order this one can be completed to
+		week_bitmap first_completion;
+		week_bitmap included;
+		unsigned int decided_classes;
+		unsigned int included_times;
+	};
+
+	struct is_popped_after
+	{
+		bool operator()(const node& first, const node& second) const
+		{
+			if (first.bound != second.bound)
+			{
+				return first.bound < second.bound;
+			}
+			return is_week_enumerated_before(second.first_completion, first.first_completion);
+		}
+	};
+
+	void build_classes();
+	bool next(week_solution& solution);
+	long long gains_bound(unsigned int decided_classes, unsigned int remaining_times);
+	void push(week_bitmap included, unsigned int decided_classes, unsigned int included_times, long long parent_bound);
+
+	const unsigned int raid_times;
+	const roster& players;
+	const single_player_value_lookup_table values;
+	const player_gain_tables tables;
+	std::vector<slot_class> classes;
+	// Slots of classes from given one to the last, in the order of the week
+	std::vector<std::vector<unsigned int> > undecided_slots;
+	std::vector<week_bitmap> undecided_masks;
+	std::priority_queue<node, std::vector<node>, is_popped_after> frontier;
+	unsigned long long generated = 0;
+	unsigned long long bounded = 0;
+	// Buffers of push
+	std::vector<unsigned int> table_index;
+	std::vector<std::pair<long long, unsigned int> > class_gains;
+	std::vector<unsigned int> taken_slots;
+	std::vector<long long> gain_caps;
+	std::vector<int> capped_parts;
+	std::vector<long long> player_gains;
+};
+
+/*****************************************************************************/
+// Leave-one-out impact
+//
+// How much each player drives the optimum: best solution of single raid when
+// the player is removed. Value of solution without a player is its total value
+// minus contribution of the player, so all solutions are scored once and for
+// every player the best remainder is kept, players with the same preferences
+// share it. Cost is close to one enumeration of all solutions.
+
+struct player_impact
+{
+	// Best solution without the player
+	scored_solution optimum_without;
+	// Value of the optimum of all players without contribution of the player
+	long long old_optimum_value;
+	// Old optimum is worse than the best solution without the player, when it
+	// only ties the optimum is kept
+	bool optimum_changed;
+};
+
+/* Fills impacts in the order of players and returns the optimum of all players */
+scored_solution leave_one_out_impact(const config_header& header, const roster& players, std::vector<player_impact>& impacts);
+
+/*****************************************************************************/
+// Solver context
+//
+// Owns roster of one raid together with lookup table and buffers used by
+// search, so that programs embedding the solver can load roster once and solve
+// repeatedly. Nothing is printed: warnings of parser are collected and results
+// are returned as data. Buffers are kept between solves, after the first solve
+// further ones with no more solutions requested don't allocate memory.
+
+class solver_context
+{
+public:
+	/* Replaces roster with one parsed from input in the format of input.txt,
+	 * after parse_error line_number() and line() tell where it happened.
+	 * Only single raid is supported.
+	 */
+	void load(const std::string& input);
+	void clear();
+
+	const config_header& header() const;
+	const roster& players() const;
+	const std::vector<std::string>& warnings() const;
+	unsigned int line_number() const;
+	const std::string& line() const;
+
+	/* Best max_solutions solutions in the order raid_start_times presents
+	 * them: by value, solutions of equal value in order of enumeration.
+	 */
+	const std::vector<scored_solution>& solve(size_t max_solutions = max_solutions_to_present);
+	const std::vector<scored_solution>& solutions() const;
+	player_score score(const time_bitmap& solution, size_t player_index) const;
+
+	/* True when any player has weekday qualified list, then the whole week is
+	 * solved by solve_week() instead of solve(). Weekly solves allocate their
+	 * search buffers every time.
+	 */
+	bool weekly() const;
+	const std::vector<week_solution>& solve_week(size_t max_solutions = max_solutions_to_present);
+	const std::vector<week_solution>& week_solutions() const;
+	player_score score_week(const week_bitmap& solution, size_t player_index) const;
+
+private:
+	void load_line(const std::string& line);
+
+	config_header_parser header_parser;
+	roster members;
+	std::vector<std::string> parse_warnings;
+	single_player_value_lookup_table values;
+	unsigned int current_line_number = 0;
+	std::string current_line;
+
+	std::vector<scored_solution> results;
+	all_solutions_iterator iterator;
+	std::vector<week_solution> week_results;
+};
+
+#endif // RAID_SOLVER_HPP
@@ -0,0 +1,187 @@
+#include "raid_solver_c.h"
+#include "raid_solver_internal.hpp"
+
+#include <new>
+#include <sstream>
+
+/* Exceptions must not cross C interface, everything is caught here and turned
+ * into error message of the context.
+ */
+struct rst_context
+{
+	solver_context solver;
+	std::string error;
+};
+
+rst_context* rst_create(void)
+{
+	return new (std::nothrow) rst_context();
+}
+
+void rst_destroy(rst_context* context)
+{
+	delete context;
+}
+
+const char* rst_last_error(const rst_context* context)
+{
+	return context->error.c_str();
+}
+
+int rst_load(rst_context* context, const char* input, size_t length)
+{
+	try
+	{
+		context->solver.load(std::string(input, length));
+		return 0;
+	}
+	catch (parse_error& e)
+	{
+		const std::string& line = context->solver.line();
+		const size_t position = std::min(e.get_position(), line.size());
+		std::ostringstream message;
+		message << "At line: " << context->solver.line_number() << ", " << POS_PRINT(line, position) << e.what();
+		context->error = message.str();
+	}
+	catch (std::exception& e)
+	{
+		context->error = e.what();
+	}
+	context->solver.clear();
+	return -1;
+}
+
+int rst_weekly(const rst_context* context)
+{
+	return context->solver.weekly() ? 1 : 0;
+}
+
+size_t rst_warning_count(const rst_context* context)
+{
+	return context->solver.warnings().size();
+}
+
+const char* rst_warning(const rst_context* context, size_t index)
+{
+	const auto& warnings = context->solver.warnings();
+	return index < warnings.size() ? warnings[index].c_str() : nullptr;
+}
+
+size_t rst_player_count(const rst_context* context)
+{
+	return context->solver.players().size();
+}
+
+const char* rst_player_name(const rst_context* context, size_t player)
+{
+	const auto& players = context->solver.players();
+	return player < players.size() ? players.name(player) : nullptr;
+}
+
+int rst_solve(rst_context* context, size_t max_solutions)
+{
+	try
+	{
+		if (context->solver.weekly())
+		{
+			context->solver.solve_week(max_solutions);
+		}
+		else
+		{
+			context->solver.solve(max_solutions);
+		}
+		return 0;
+	}
+	catch (std::exception& e)
+	{
+		context->error = e.what();
+	}
+	return -1;
+}
+
+size_t rst_solution_count(const rst_context* context)
+{
+	if (context->solver.weekly())
+	{
+		return context->solver.week_solutions().size();
+	}
+	return context->solver.solutions().size();
+}
+
+long long rst_solution_value(const rst_context* context, size_t solution)
+{
+	if (context->solver.weekly())
+	{
+		const auto& solutions = context->solver.week_solutions();
+		return solution < solutions.size() ? solutions[solution].value : 0;
+	}
+	const auto& solutions = context->solver.solutions();
+	return solution < solutions.size() ? solutions[solution].first : 0;
+}
+
+unsigned int rst_solution_hours(const rst_context* context, size_t solution)
+{
+	if (context->solver.weekly())
+	{
+		return 0;
+	}
+	const auto& solutions = context->solver.solutions();
+	return solution < solutions.size() ? solutions[solution].second.get_data() : 0;
+}
+
+size_t rst_solution_week_slots(const rst_context* context, size_t solution, unsigned int* slots, size_t capacity)
+{
+	const auto& solutions = context->solver.week_solutions();
+	if (!context->solver.weekly() || solution >= solutions.size())
+	{
+		return 0;
+	}
+	size_t count = 0;
+	for (unsigned int slot = 0; slot < hours_in_week; ++slot)
+	{
+		if (solutions[solution].slots.test(slot))
+		{
+			if (count < capacity)
+			{
+				slots[count] = slot;
+			}
+			++count;
+		}
+	}
+	return count;
+}
+
+double rst_solution_equivalent(const rst_context* context, size_t solution)
+{
+	const auto& solutions = context->solver.week_solutions();
+	if (!context->solver.weekly() || solution >= solutions.size())
+	{
+		return solution < rst_solution_count(context) ? 1 : 0;
+	}
+	return solutions[solution].equivalent;
+}
+
+int rst_player_score(const rst_context* context, size_t solution, size_t player,
+		unsigned int* best_times, unsigned int* acceptable_times, long long* value)
+{
+	if (solution >= rst_solution_count(context) || player >= context->solver.players().size())
+	{
+		return -1;
+	}
+	const player_score score = context->solver.weekly() ?
+		context->solver.score_week(context->solver.week_solutions()[solution].slots, player) :
+		context->solver.score(context->solver.solutions()[solution].second, player);
+	if (best_times)
+	{
+		*best_times = score.best_times;
+	}
+	if (acceptable_times)
+	{
+		*acceptable_times = score.acceptable_times;
+	}
+	if (value)
+	{
+		*value = score.best_value + score.acceptable_value;
+	}
+	return 0;
+}
@@ -0,0 +1,59 @@
+#ifndef RAID_SOLVER_C_H
+#define RAID_SOLVER_C_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* C interface of solver_context, for programs which embed the solver but are
+ * not written in C++. Functions returning int return 0 on success and -1 on
+ * failure, then rst_last_error describes the problem. Strings returned are
+ * owned by the context and valid until it is loaded again or destroyed.
+ * With index out of range getters return 0 or NULL and rst_player_score -1.
+ */
+
+typedef struct rst_context rst_context;
+
+/* Returns NULL when out of memory */
+rst_context* rst_create(void);
+void rst_destroy(rst_context* context);
+const char* rst_last_error(const rst_context* context);
+
+/* Input in the format of input.txt, single raid */
+int rst_load(rst_context* context, const char* input, size_t length);
+/* Returns 1 when any player has weekday qualified list, solutions are then
+ * slots of the whole week, 0 otherwise
+ */
+int rst_weekly(const rst_context* context);
+size_t rst_warning_count(const rst_context* context);
+const char* rst_warning(const rst_context* context, size_t index);
+size_t rst_player_count(const rst_context* context);
+const char* rst_player_name(const rst_context* context, size_t player);
+
+/* Finds best max_solutions solutions, from the best one */
+int rst_solve(rst_context* context, size_t max_solutions);
+size_t rst_solution_count(const rst_context* context);
+long long rst_solution_value(const rst_context* context, size_t solution);
+/* Bit n is set when raid starts at hour n in guild reset timezone, 0 for
+ * weekly roster
+ */
+unsigned int rst_solution_hours(const rst_context* context, size_t solution);
+/* Slots of weekly solution (day * 24 + hour, Monday is day 0) in guild reset
+ * timezone, at most capacity of them are stored. Returns number of slots of
+ * the solution, 0 for daily roster.
+ */
+size_t rst_solution_week_slots(const rst_context* context, size_t solution, unsigned int* slots, size_t capacity);
+/* Number of weekly solutions with the same value which differ only by slots
+ * every player likes the same, 1 for daily roster
+ */
+double rst_solution_equivalent(const rst_context* context, size_t solution);
+int rst_player_score(const rst_context* context, size_t solution, size_t player,
+		unsigned int* best_times, unsigned int* acceptable_times, long long* value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RAID_SOLVER_C_H */
@@ -0,0 +1,35 @@
+#ifndef RAID_SOLVER_INTERNAL_HPP
+#define RAID_SOLVER_INTERNAL_HPP
+
+// Helpers shared by the library and programs built in this repository, not
+// part of interface of the library.
+
+#include <iostream>
+
+#include "raid_solver.hpp"
+
+/*****************************************************************************/
+// Debug macros
+
+#ifndef DEBUG
+#define DEBUG 0
+#endif
+
+#if DEBUG
+#define DEBUG_LOG \
+	std::cout
+#else
+#define DEBUG_LOG \
+	if (0) std::cout
+#endif
+
+/*****************************************************************************/
+// Parsing helpers
+
+#define MARK_ERROR(line, position) \
+	line << "\n" << spacer(line, position) << "^" << "\n"
+
+#define POS_PRINT(line, position) \
+	"position: " << position << "\n" << MARK_ERROR(line, position)
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef ROSTER_GENERATOR_HPP
+#define ROSTER_GENERATOR_HPP
+
+#include <ostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*****************************************************************************/
+// Synthetic roster generator
+//
+// Emits input in the same format as input.txt (header followed by one line per
+// guild member), so generated rosters can be fed to raid_start_times directly.
+// Only std::mt19937 output is used (distributions from <random> differ between
+// standard libraries), so the same seed gives the same roster everywhere.
+
+struct roster_generator_options
+{
+	enum distribution_id
+	{
+		// Random hours, random reset times
+		uniform,
+		// Most members live near guild timezone and prefer evenings
+		evening,
+		// Members spread over all timezones, each prefers his local evening
+		timezones,
+		// Few distinct profiles shared by many members
+		duplicates,
+		number_of_distributions
+	};
+
+	static const char* distribution_name(distribution_id distribution)
+	{
+		static const char* const names[number_of_distributions] = {"uniform", "evening", "timezones", "duplicates"};
+		return names[distribution];
+	}
+
+	/* Generated header must be valid input of raid_start_times */
+	static bool is_valid_raid_times(unsigned int raid_times)
+	{
+		return raid_times >= 1 && raid_times <= 23;
+	}
+
+	unsigned int players = 50;
+	unsigned int raid_times = 3;
+	distribution_id distribution = evening;
+	unsigned int seed = 1;
+
+	static distribution_id parse_distribution(const std::string& name)
+	{
+		for (unsigned int i = 0; i < number_of_distributions; ++i)
+		{
+			if (name == distribution_name(static_cast<distribution_id>(i)))
+			{
+				return static_cast<distribution_id>(i);
+			}
+		}
+		throw std::runtime_error("Unknown distribution: " + name + ", expected uniform, evening, timezones or duplicates");
+	}
+};
+
+class roster_generator
+{
+public:
+	explicit roster_generator(const roster_generator_options& o) :
+		options(o),
+		random(o.seed)
+	{
+	}
+
+	void generate(std::ostream& stream)
+	{
+		stream << "# Synthetic roster: " << options.players << " players, distribution " <<
+			roster_generator_options::distribution_name(options.distribution) << ", seed " << options.seed << "\n";
+		stream << "Number of best raid times to seek: " << options.raid_times << "\n";
+		stream << "Guild activities reset time for results: " << guild_reset_hour << ":30\n";
+		stream << "Best times weights list: 10000, 1000, 10\n";
+		stream << "Acceptable times weights list: 1000, 100, 1\n";
+
+		std::vector<std::string> profiles;
+		if (options.distribution == roster_generator_options::duplicates)
+		{
+			const unsigned int number_of_profiles = 8;
+			for (unsigned int i = 0; i < number_of_profiles; ++i)
+			{
+				profiles.push_back(preferences(evening_member_reset_hour(), 19, 3));
+			}
+		}
+
+		for (unsigned int i = 0; i < options.players; ++i)
+		{
+			stream << "Member " << i + 1 << ", ";
+			switch (options.distribution)
+			{
+			case roster_generator_options::uniform:
+				stream << uniform_preferences();
+				break;
+			case roster_generator_options::evening:
+				stream << preferences(evening_member_reset_hour(), 19, 3);
+				break;
+			case roster_generator_options::timezones:
+				stream << preferences(next(24), 18 + next(4), 3);
+				break;
+			case roster_generator_options::duplicates:
+				stream << profiles[next(profiles.size())];
+				break;
+			default:
+				throw std::runtime_error("Invalid distribution");
+			}
+			stream << "\n";
+		}
+	}
+
+private:
+	static const unsigned int guild_reset_hour = 18;
+
+	const roster_generator_options options;
+	std::mt19937 random;
+
+	unsigned int next(unsigned int limit)
+	{
+		return random() % limit;
+	}
+
+	/* Guild timezone with some members up to 2 hours off */
+	unsigned int evening_member_reset_hour()
+	{
+		return (guild_reset_hour + 22 + next(5)) % 24;
+	}
+
+	static std::string reset(unsigned int hour)
+	{
+		return "reset(" + std::to_string(hour) + ":30)";
+	}
+
+	static std::string list(const std::string& name, const std::vector<unsigned int>& hours)
+	{
+		std::string retval = name + "(";
+		for (size_t i = 0; i < hours.size(); ++i)
+		{
+			retval += (i ? "," : "") + std::to_string(hours[i]);
+		}
+		return retval + ")";
+	}
+
+	std::string uniform_preferences()
+	{
+		std::vector<unsigned int> best;
+		std::vector<unsigned int> acceptable;
+		for (unsigned int hour = 0; hour < 24; ++hour)
+		{
+			const unsigned int draw = next(8);
+			if (draw == 0)
+			{
+				best.push_back(hour);
+			}
+			else if (draw == 1)
+			{
+				acceptable.push_back(hour);
+			}
+		}
+		return reset(next(24)) + ", " + list("best", best) + ", " + list("acceptable", acceptable);
+	}
+
+	/* Best hours clustered around favourite local hour, acceptable ones around
+	 * the best ones, everything in member local time.
+	 */
+	std::string preferences(unsigned int reset_hour, unsigned int favourite_hour, unsigned int spread)
+	{
+		const unsigned int center = favourite_hour + next(2 * spread + 1) + 24 - spread;
+		const unsigned int best_length = 1 + next(4);
+		const unsigned int best_start = center - best_length / 2;
+		std::vector<unsigned int> best;
+		for (unsigned int hour = best_start; hour < best_start + best_length; ++hour)
+		{
+			best.push_back(hour % 24);
+		}
+		std::vector<unsigned int> acceptable;
+		for (unsigned int i = 1 + next(3); i > 0; --i)
+		{
+			acceptable.push_back((best_start + 24 - i) % 24);
+		}
+		for (unsigned int i = next(3); i > 0; --i)
+		{
+			acceptable.push_back((best_start + best_length + i - 1) % 24);
+		}
+		return reset(reset_hour) + ", " + list("best", best) + ", " + list("acceptable", acceptable);
+	}
+};
+
+#endif // ROSTER_GENERATOR_HPP